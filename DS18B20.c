@@ -21,6 +21,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+//CPU frequency required for util library
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#include <util/delay.h>
 
 /**************************************************************
                           Macros
@@ -29,20 +34,36 @@
 #define WRITE_SCRATCHPAD_CMD 0x4E
 #define READ_SCRATCHPAD_CMD  0xBE
 #define CONVERT_TEMP_CMD     0x44
+#define COPY_SCRATCHPAD_CMD  0x48
+#define RECALL_E2_CMD        0xB8
 
 #define SCRATCHPAD_LEN_BYTES 9
 #define EXPECTED_CRC_IDX 8
 #define TEMP_HI_IDX 1
 #define TEMP_LO_IDX 0
+#define TH_IDX 2
+#define TL_IDX 3
+#define CONFIG_IDX 4
+#define RESERVED_IDX 6
 
-//precision of temperature reading
-#define PRECISION 0.0625F
+//reserved byte 6 reads 0x0C in the power-up image, 0x10 after a conversion
+#define POWER_ON_RESERVED 0x0C
+
+//configuration register holds the resolution in bits 6:5
+#define CONFIG_RES_SHIFT 5
+#define CONFIG_RES_MASK 0x03
+#define CONFIG_RESERVED_BITS 0x1F
+#define MIN_RESOLUTION_BITS 9
+#define MAX_RESOLUTION_BITS 12
+
+//EEPROM write time after COPY SCRATCHPAD (tWR)
+#define EEPROM_WRITE_MS 10
 
 /**************************************************************
                     Private Function Prototypes
 ***************************************************************/
 static bool scratchpad_crc(uint8_t *scratchpad);
-static bool read_scratchpad(ds18b20_dev_t *dev, uint8_t *scratchpad);
+static ds18b20_status_t read_scratchpad(uint8_t *rom, uint8_t pin, uint8_t *scratchpad);
 
 /*!
  * @brief Computes the CRC8 of the Scratchpad
@@ -72,32 +93,43 @@ static bool scratchpad_crc(uint8_t *scratchpad)
 
 /*!
  * @brief Reads Scratchpad and calculates the CRC8 of received data.
- * @param[in] dev Pointer to DS18B20 device structure.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @param[in] pin OWI bus pin where device is connected.
  * @param[out] scratchpad Buffer to hold scratchpad memory data.
- * @return bool
+ * @return ds18b20_status_t
  */
-static bool read_scratchpad(ds18b20_dev_t *dev, uint8_t *scratchpad)
+static ds18b20_status_t read_scratchpad(uint8_t *rom, uint8_t pin, uint8_t *scratchpad)
 {
-  bool err = false;
+  ds18b20_status_t status = DS18B20_OK;
   uint8_t idx = 0;
   
   //verify OWI device is on bus
-  owi_detect_presence(dev->pin);
-  //address the DS18B20 sensor
-  owi_match_rom(dev->rom, dev->pin);
-  //send Read Scratchpad command
-  owi_send_byte(READ_SCRATCHPAD_CMD, dev->pin);
-  
-  //read the entire scratchpad memory
-  for (idx = 0; idx < SCRATCHPAD_LEN_BYTES; idx++)
+  if (!owi_detect_presence(pin))
   {
-    scratchpad[idx] = owi_recv_byte(dev->pin);
+    status = DS18B20_ERR_PRESENCE;
   }
   
-  //compute the CRC8 of the scratchpad data
-  err = scratchpad_crc(scratchpad);
+  if (status == DS18B20_OK)
+  {
+    //address the DS18B20 sensor
+    owi_match_rom(rom, pin);
+    //send Read Scratchpad command
+    owi_send_byte(READ_SCRATCHPAD_CMD, pin);
+    
+    //read the entire scratchpad memory
+    for (idx = 0; idx < SCRATCHPAD_LEN_BYTES; idx++)
+    {
+      scratchpad[idx] = owi_recv_byte(pin);
+    }
+    
+    //compute the CRC8 of the scratchpad data
+    if (scratchpad_crc(scratchpad))
+    {
+      status = DS18B20_ERR_CRC;
+    }
+  }
 
-  return err;
+  return status;
 }
 
 /**************************************************************
@@ -115,6 +147,7 @@ bool ds18b20_init(ds18b20_dev_t *dev, uint8_t pin)
   
   if (!err)
   {
+    dev->raw = 0;
     dev->temp = 0;
     dev->pin = pin;
     owi_init(pin);
@@ -149,7 +182,7 @@ bool ds18b20_get_rom(ds18b20_dev_t *dev)
 bool ds18b20_read_temp(ds18b20_dev_t *dev)
 {
   bool err = false;
-  uint16_t raw_temp = 0;
+  int16_t raw_temp = 0;
   uint8_t scratchpad[SCRATCHPAD_LEN_BYTES];
   
   owi_detect_presence(dev->pin);
@@ -160,17 +193,201 @@ bool ds18b20_read_temp(ds18b20_dev_t *dev)
   //wait for conversion to complete
   while (owi_is_busy(dev->pin));
 
-  err = read_scratchpad(dev, scratchpad);
+  err = (read_scratchpad(dev->rom, dev->pin, scratchpad) != DS18B20_OK);
   
   if (!err)
   {
     //complete transaction
     owi_detect_presence(dev->pin);
     //format temperature data
-    raw_temp = (scratchpad[TEMP_HI_IDX] << 8) | scratchpad[TEMP_LO_IDX];
+    raw_temp = (int16_t)((scratchpad[TEMP_HI_IDX] << 8) | scratchpad[TEMP_LO_IDX]);
+    dev->raw = raw_temp;
     //convert to readable format (in Celsius)
-    dev->temp = ((float)raw_temp * PRECISION);
+    dev->temp = ((float)raw_temp * DS18B20_PRECISION);
+  }
+  
+  return err;
+}
+
+//See DS18B20.h
+bool ds18b20_convert_all(uint8_t pin)
+{
+  bool err = false;
+  
+  err = ds18b20_start_convert_all(pin);
+  
+  if (!err)
+  {
+    //wait for all conversions to complete
+    while (owi_is_busy(pin));
   }
   
   return err;
-}
+}
+
+//See DS18B20.h
+bool ds18b20_start_convert_all(uint8_t pin)
+{
+  bool err = false;
+  bool present;
+  
+  //check if any DS18B20 device is present
+  present = owi_detect_presence(pin);
+  
+  if (!present)
+  {
+    err = true;
+  }
+  
+  if (!err)
+  {
+    //address every device on the bus at once
+    owi_skip_rom(pin);
+    //send Convert Temperature memory command
+    owi_send_byte(CONVERT_TEMP_CMD, pin);
+  }
+  
+  return err;
+}
+
+//See DS18B20.h
+bool ds18b20_start_convert(uint8_t *rom, uint8_t pin)
+{
+  bool err = false;
+  bool present;
+  
+  //check if DS18B20 device is present
+  present = owi_detect_presence(pin);
+  
+  if (!present)
+  {
+    err = true;
+  }
+  
+  if (!err)
+  {
+    //address the DS18B20 sensor
+    owi_match_rom(rom, pin);
+    //send Convert Temperature memory command
+    owi_send_byte(CONVERT_TEMP_CMD, pin);
+  }
+  
+  return err;
+}
+
+//See DS18B20.h
+bool ds18b20_read_raw(uint8_t *rom, uint8_t pin, int16_t *raw)
+{
+  ds18b20_status_t status;
+  
+  status = ds18b20_readout(rom, pin, raw);
+  
+  //the power-on value is still a well-formed reading
+  return ((status != DS18B20_OK) && (status != DS18B20_ERR_POWER_ON));
+}
+
+//See DS18B20.h
+ds18b20_status_t ds18b20_readout(uint8_t *rom, uint8_t pin, int16_t *raw)
+{
+  ds18b20_status_t status;
+  uint8_t scratchpad[SCRATCHPAD_LEN_BYTES];
+  
+  status = read_scratchpad(rom, pin, scratchpad);
+  
+  if (status == DS18B20_OK)
+  {
+    //complete transaction
+    owi_detect_presence(pin);
+    //format temperature data
+    *raw = (int16_t)((scratchpad[TEMP_HI_IDX] << 8) | scratchpad[TEMP_LO_IDX]);
+    
+    //a converted 85.0 C reading differs from the power-up image in byte 6
+    if ((*raw == DS18B20_POWER_ON_RAW) &&
+        (scratchpad[RESERVED_IDX] == POWER_ON_RESERVED))
+    {
+      status = DS18B20_ERR_POWER_ON;
+    }
+  }
+  
+  return status;
+}
+
+//See DS18B20.h
+bool ds18b20_broadcast_config(uint8_t pin, ds18b20_config_t *config)
+{
+  bool err = false;
+  
+  if ((config->resolution < MIN_RESOLUTION_BITS) ||
+      (config->resolution > MAX_RESOLUTION_BITS))
+  {
+    err = true;
+  }
+  
+  //write TH, TL and configuration to every scratchpad at once
+  if (!err)
+  {
+    err = !owi_detect_presence(pin);
+  }
+  
+  if (!err)
+  {
+    owi_skip_rom(pin);
+    owi_send_byte(WRITE_SCRATCHPAD_CMD, pin);
+    owi_send_byte((uint8_t)config->th, pin);
+    owi_send_byte((uint8_t)config->tl, pin);
+    owi_send_byte((uint8_t)(((config->resolution - MIN_RESOLUTION_BITS) <<
+                             CONFIG_RES_SHIFT) | CONFIG_RESERVED_BITS), pin);
+    
+    err = !owi_detect_presence(pin);
+  }
+  
+  //copy every scratchpad to EEPROM at once
+  if (!err)
+  {
+    owi_skip_rom(pin);
+    owi_send_byte(COPY_SCRATCHPAD_CMD, pin);
+    //devices do not signal the end of the copy, wait out tWR
+    _delay_ms(EEPROM_WRITE_MS);
+  }
+  
+  return err;
+}
+
+//See DS18B20.h
+bool ds18b20_broadcast_recall(uint8_t pin)
+{
+  bool err = false;
+  
+  err = !owi_detect_presence(pin);
+  
+  if (!err)
+  {
+    owi_skip_rom(pin);
+    owi_send_byte(RECALL_E2_CMD, pin);
+    //wait for all devices to finish the recall
+    while (owi_is_busy(pin));
+  }
+  
+  return err;
+}
+
+//See DS18B20.h
+ds18b20_status_t ds18b20_read_config(uint8_t *rom, uint8_t pin, ds18b20_config_t *config)
+{
+  ds18b20_status_t status;
+  uint8_t scratchpad[SCRATCHPAD_LEN_BYTES];
+  
+  status = read_scratchpad(rom, pin, scratchpad);
+  
+  if (status == DS18B20_OK)
+  {
+    //complete transaction
+    owi_detect_presence(pin);
+    config->th = (int8_t)scratchpad[TH_IDX];
+    config->tl = (int8_t)scratchpad[TL_IDX];
+    config->resolution = ((scratchpad[CONFIG_IDX] >> CONFIG_RES_SHIFT) & CONFIG_RES_MASK) +
+                         MIN_RESOLUTION_BITS;
+  }
+  
+  return status;
+}
@@ -19,19 +19,64 @@ extern "C" {
 /**************************************************************
                           Includes
 ***************************************************************/
+#include "owi_delay.h"
 #include <stdint.h>
 #include <stdbool.h>
 
 /**************************************************************
                            Macros
 ***************************************************************/
+//DS18B20 family code (first ROM byte on the wire)
+#define DS18B20_FAMILY_CODE 0x28
+
+/*
+ * ROM buffer layout used by the driver. The family code is
+ * received first and stored in the last byte, the CRC is
+ * received last and stored in the first byte.
+ */
+#define DS18B20_ROM_LEN_BYTES 8
+#define DS18B20_ROM_FAMILY_IDX 7
+#define DS18B20_ROM_CRC_IDX 0
+
+//configured conversion resolution (9 to 12 bits)
+#ifndef DS18B20_RESOLUTION_BITS
+#define DS18B20_RESOLUTION_BITS 12
+#endif
+
+//worst-case conversion time in milliseconds for the resolution
+#define DS18B20_CONVERSION_MS (750 >> (12 - DS18B20_RESOLUTION_BITS))
+
+//bus time in microseconds of the transactions around a conversion
+#define DS18B20_CONVERT_ALL_US (OWI_RESET_US + (16 * OWI_SLOT_US))
+#define DS18B20_CONVERT_US     (OWI_RESET_US + (80 * OWI_SLOT_US))
+#define DS18B20_READOUT_US     ((2 * OWI_RESET_US) + (152 * OWI_SLOT_US))
+
+//degrees Celsius per bit of a raw reading
+#define DS18B20_PRECISION 0.0625F
+
+//raw reading held by the sensor before its first conversion (85 C)
+#define DS18B20_POWER_ON_RAW 0x0550
 
 /**************************************************************
                           Typedefs
 ***************************************************************/
+typedef enum {
+  DS18B20_OK = 0,
+  DS18B20_ERR_PRESENCE,
+  DS18B20_ERR_CRC,
+  DS18B20_ERR_POWER_ON
+} ds18b20_status_t;
+
+typedef struct {
+  int8_t   th;
+  int8_t   tl;
+  uint8_t  resolution;
+} ds18b20_config_t;
+
 typedef struct {
   uint8_t  pin;
   uint8_t  rom[8];
+  int16_t  raw;
   float    temp;
 } ds18b20_dev_t;
 
@@ -58,14 +103,97 @@ bool ds18b20_get_rom(ds18b20_dev_t *dev);
 /*!
 * @brief Reads the temperature value in degrees Celsius from the
 * DS18B20 thermometer. Temperature is read into the temperature
-* floating point variable in the device structure.
+* floating point variable in the device structure, the raw reading
+* in units of 1/16 degrees Celsius is kept alongside.
 * @param[in] dev Pointer to device structure.
 * @return bool
 */
 bool ds18b20_read_temp(ds18b20_dev_t *dev);
 
+/*!
+ * @brief Issues a Convert Temperature command to every DS18B20
+ * device on the OWI bus at once using SKIP ROM and waits for
+ * the conversions to complete.
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @return bool
+ */
+bool ds18b20_convert_all(uint8_t pin);
+
+/*!
+ * @brief Issues a Convert Temperature command to every DS18B20
+ * device on the OWI bus at once using SKIP ROM. Returns as soon
+ * as the command is sent; completion can be polled with
+ * owi_is_busy().
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @return bool
+ */
+bool ds18b20_start_convert_all(uint8_t pin);
+
+/*!
+ * @brief Issues a Convert Temperature command to the addressed
+ * DS18B20 device. Returns as soon as the command is sent.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @param[in] pin OWI bus pin where device is connected.
+ * @return bool
+ */
+bool ds18b20_start_convert(uint8_t *rom, uint8_t pin);
+
+/*!
+ * @brief Reads the raw temperature register of the addressed
+ * DS18B20 device. Does not start a conversion. The raw value
+ * is in units of 1/16 degrees Celsius.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @param[in] pin OWI bus pin where device is connected.
+ * @param[out] raw Raw signed temperature reading.
+ * @return bool
+ */
+bool ds18b20_read_raw(uint8_t *rom, uint8_t pin, int16_t *raw);
+
+/*!
+ * @brief Reads the raw temperature register of the addressed
+ * DS18B20 device and reports why the readout failed. A scratchpad
+ * still holding the power-up image is stored in raw but reported
+ * as DS18B20_ERR_POWER_ON since the conversion did not run. A
+ * converted reading of 85.0 C is reported as DS18B20_OK.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @param[in] pin OWI bus pin where device is connected.
+ * @param[out] raw Raw signed temperature reading.
+ * @return ds18b20_status_t
+ */
+ds18b20_status_t ds18b20_readout(uint8_t *rom, uint8_t pin, int16_t *raw);
+
+/*!
+ * @brief Writes the alarm thresholds and resolution to every
+ * DS18B20 device on the OWI bus at once using SKIP ROM and copies
+ * them to EEPROM. Waits the 10 ms EEPROM write time before
+ * returning.
+ * Resolution must be between 9 and 12 bits.
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @param[in] config Pointer to configuration to write.
+ * @return bool
+ */
+bool ds18b20_broadcast_config(uint8_t pin, ds18b20_config_t *config);
+
+/*!
+ * @brief Reloads the alarm thresholds and configuration from
+ * EEPROM into the scratchpad of every DS18B20 device at once.
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @return bool
+ */
+bool ds18b20_broadcast_recall(uint8_t pin);
+
+/*!
+ * @brief Reads the alarm thresholds and resolution from the
+ * scratchpad of the addressed DS18B20 device.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @param[in] pin OWI bus pin where device is connected.
+ * @param[out] config Configuration read from the device.
+ * @return ds18b20_status_t
+ */
+ds18b20_status_t ds18b20_read_config(uint8_t *rom, uint8_t pin, ds18b20_config_t *config);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif /* _DS18B20_H */
+#endif /* _DS18B20_H */
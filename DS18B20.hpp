@@ -0,0 +1,564 @@
+/***************************************************************
+ * @file ds18b20.hpp
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Header-only C++ layer for the DS18B20 Digital Thermometer.
+ * The OWI port and pin are template parameters, so every bus
+ * access compiles to single-bit instructions on a constant I/O
+ * address. ROMs known at build time are compile-time constants
+ * and MATCH ROM sequences are emitted as unrolled bit streams.
+ * Requires C++11. Does not depend on the C driver.
+ *
+ * Example:
+ *   typedef ds18b20::Bus<ds18b20::PortD, 2> Bus2;
+ *   typedef ds18b20::Rom<0x28,0xFF,0x4C,0x60,0x91,0x16,0x04,0xB4> Rom0;
+ *   typedef ds18b20::Sensor<Bus2, Rom0> Probe0;
+ *   ds18b20::Sweep<Probe0, Probe1>::run(raw);
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_HPP
+#define _DS18B20_HPP
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "owi_delay.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+//CPU frequency required for util library
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#include <util/delay.h>
+
+namespace ds18b20 {
+
+/**************************************************************
+                          Constants
+***************************************************************/
+//ROM Commands
+static const uint8_t SKIP_ROM_CMD  = 0xCC;
+static const uint8_t MATCH_ROM_CMD = 0x55;
+
+//memory Commands
+static const uint8_t READ_SCRATCHPAD_CMD = 0xBE;
+static const uint8_t CONVERT_TEMP_CMD    = 0x44;
+
+static const uint8_t FAMILY_CODE          = 0x28;
+static const uint8_t ROM_LEN_BYTES        = 8;
+static const uint8_t SCRATCHPAD_LEN_BYTES = 9;
+static const uint8_t EXPECTED_CRC_IDX     = 8;
+static const uint8_t TEMP_HI_IDX          = 1;
+static const uint8_t TEMP_LO_IDX          = 0;
+
+/**************************************************************
+                          Utilities
+***************************************************************/
+/*!
+ * @brief Computes the CRC8 of a byte of data. Usable both at
+ * compile time and at run time. Matches crc8() in owi_crc.c.
+ * @param[in] data Data byte to perform CRC on.
+ * @param[in] seed CRC seed value.
+ * @param[in] bits Number of bits left to process.
+ * @return uint8_t
+ */
+constexpr uint8_t crc8(uint8_t data, uint8_t seed, uint8_t bits = 8)
+{
+  return (bits == 0) ? seed :
+    crc8(data >> 1,
+         ((data ^ seed) & 0x01) ? ((seed >> 1) ^ 0x8C) : (seed >> 1),
+         bits - 1);
+}
+
+/*!
+ * @brief Computes the CRC8 of a list of bytes at compile time.
+ * @param[in] seed CRC seed value.
+ * @return uint8_t
+ */
+constexpr uint8_t crc8_bytes(uint8_t seed)
+{
+  return seed;
+}
+
+template <typename... Rest>
+constexpr uint8_t crc8_bytes(uint8_t seed, uint8_t first, Rest... rest)
+{
+  return crc8_bytes(crc8(first, seed), rest...);
+}
+
+namespace detail {
+
+template <bool B> struct BitTag {};
+
+template <uint8_t First, uint8_t... Rest> struct FirstByte
+{
+  static const uint8_t value = First;
+};
+
+template <typename A, typename B> struct IsSame { static const bool value = false; };
+template <typename A> struct IsSame<A, A> { static const bool value = true; };
+
+/*
+ * True if any sensor in the list lives on the given bus.
+ */
+template <typename B, typename... Sensors> struct UsesBus;
+
+template <typename B> struct UsesBus<B>
+{
+  static const bool value = false;
+};
+
+template <typename B, typename S, typename... Rest> struct UsesBus<B, S, Rest...>
+{
+  static const bool value = IsSame<B, typename S::bus>::value ||
+                            UsesBus<B, Rest...>::value;
+};
+
+} /* namespace detail */
+
+/**************************************************************
+                            Ports
+***************************************************************/
+/*
+ * Each port type exposes its three I/O registers. Register
+ * addresses are constant so the compiler emits sbi/cbi/sbis.
+ */
+struct PortB
+{
+  static volatile uint8_t &ddr()  { return DDRB; }
+  static volatile uint8_t &port() { return PORTB; }
+  static volatile uint8_t &pin()  { return PINB; }
+};
+
+struct PortC
+{
+  static volatile uint8_t &ddr()  { return DDRC; }
+  static volatile uint8_t &port() { return PORTC; }
+  static volatile uint8_t &pin()  { return PINC; }
+};
+
+struct PortD
+{
+  static volatile uint8_t &ddr()  { return DDRD; }
+  static volatile uint8_t &port() { return PORTD; }
+  static volatile uint8_t &pin()  { return PIND; }
+};
+
+/**************************************************************
+                             Bus
+***************************************************************/
+/*!
+ * @brief OWI bus on a fixed port and pin. Timing follows
+ * owi_delay.h exactly as the C driver does.
+ */
+template <typename Port, uint8_t Pin>
+class Bus
+{
+public:
+  static_assert(Pin < 8, "OWI pin must be 0-7");
+
+  /*!
+   * @brief Releases the bus and waits for it to settle.
+   * @return None.
+   */
+  static void init()
+  {
+    release();
+    _delay_us(OWI_DELAY_US_H);
+  }
+
+  /*!
+   * @brief Issues a reset and returns Boolean true if a slave
+   * device answered with a presence pulse.
+   * @return bool
+   */
+  static bool reset()
+  {
+    bool present;
+
+    cli();
+    drive_low();
+    _delay_us(OWI_DELAY_US_H);
+    release();
+    _delay_us(OWI_DELAY_US_I);
+    present = !read_value();
+    _delay_us(OWI_DELAY_US_J);
+    sei();
+
+    return present;
+  }
+
+  /*!
+   * @brief Returns Boolean true while a conversion is running.
+   * @return bool
+   */
+  static bool is_busy()
+  {
+    return !read_bit();
+  }
+
+  /*!
+   * @brief Writes a byte whose value is known at compile time.
+   * Each bit slot is selected at compile time.
+   * @return None.
+   */
+  template <uint8_t Data>
+  static void send()
+  {
+    send_bits<Data, 0>(detail::BitTag<true>());
+  }
+
+  /*!
+   * @brief Writes a list of compile-time bytes as one unrolled
+   * bit stream.
+   * @return None.
+   */
+  template <uint8_t First, uint8_t Second, uint8_t... Rest>
+  static void send()
+  {
+    send<First>();
+    send<Second, Rest...>();
+  }
+
+  /*!
+   * @brief Writes a byte known only at run time.
+   * @param[in] data Data value to write to bus.
+   * @return None.
+   */
+  static void send_byte(uint8_t data)
+  {
+    uint8_t idx;
+
+    for (idx = 0; idx < 8; idx++)
+    {
+      (data & 0x01) ? write_bit1() : write_bit0();
+      data >>= 1;
+    }
+  }
+
+  /*!
+   * @brief Reads a byte from the bus.
+   * @return uint8_t
+   */
+  static uint8_t recv_byte()
+  {
+    uint8_t idx;
+    uint8_t data = 0;
+
+    for (idx = 0; idx < 8; idx++)
+    {
+      if (read_bit())
+      {
+        data |= _BV(idx);
+      }
+    }
+
+    return data;
+  }
+
+private:
+  static void release()
+  {
+    Port::ddr() &= ~_BV(Pin);
+  }
+
+  static void drive_low()
+  {
+    Port::ddr() |= _BV(Pin);
+    Port::port() &= ~_BV(Pin);
+  }
+
+  static bool read_value()
+  {
+    return (Port::pin() & _BV(Pin));
+  }
+
+  static void write_bit1()
+  {
+    cli();
+    drive_low();
+    _delay_us(OWI_DELAY_US_A);
+    release();
+    _delay_us(OWI_DELAY_US_B);
+    sei();
+  }
+
+  static void write_bit0()
+  {
+    cli();
+    drive_low();
+    _delay_us(OWI_DELAY_US_C);
+    release();
+    _delay_us(OWI_DELAY_US_D);
+    sei();
+  }
+
+  static bool read_bit()
+  {
+    bool bit;
+
+    cli();
+    drive_low();
+    _delay_us(OWI_DELAY_US_A);
+    release();
+    _delay_us(OWI_DELAY_US_E);
+    bit = read_value();
+    _delay_us(OWI_DELAY_US_F);
+    sei();
+
+    return bit;
+  }
+
+  static void write_bit(detail::BitTag<true>)  { write_bit1(); }
+  static void write_bit(detail::BitTag<false>) { write_bit0(); }
+
+  //unrolled LSB-first bit stream of a constant byte
+  template <uint8_t Data, uint8_t Bit>
+  static void send_bits(detail::BitTag<true>)
+  {
+    write_bit(detail::BitTag<((Data >> Bit) & 0x01) != 0>());
+    send_bits<Data, Bit + 1>(detail::BitTag<(Bit + 1) < 8>());
+  }
+
+  template <uint8_t Data, uint8_t Bit>
+  static void send_bits(detail::BitTag<false>)
+  {
+  }
+};
+
+/**************************************************************
+                             ROM
+***************************************************************/
+/*!
+ * @brief DS18B20 ROM known at build time. Bytes are listed in
+ * the order they are sent on the bus: family code first, CRC
+ * last. Family code and CRC are checked at compile time.
+ */
+template <uint8_t... Bytes>
+struct Rom
+{
+  static_assert(sizeof...(Bytes) == ROM_LEN_BYTES, "ROM must be 8 bytes");
+  static_assert(detail::FirstByte<Bytes...>::value == FAMILY_CODE,
+                "not a DS18B20 family code");
+  static_assert(crc8_bytes(0, Bytes...) == 0, "ROM CRC mismatch");
+
+  /*!
+   * @brief Addresses this device with an unrolled MATCH ROM.
+   * @return None.
+   */
+  template <typename B>
+  static void match()
+  {
+    B::template send<MATCH_ROM_CMD, Bytes...>();
+  }
+
+  /*!
+   * @brief Copies the ROM into a buffer in C driver byte order,
+   * for use with owi_match_rom().
+   * @param[out] rom 8-byte buffer to store device ID.
+   * @return None.
+   */
+  static void copy(uint8_t *rom)
+  {
+    const uint8_t bytes[ROM_LEN_BYTES] = {Bytes...};
+    uint8_t idx;
+
+    for (idx = 0; idx < ROM_LEN_BYTES; idx++)
+    {
+      rom[idx] = bytes[ROM_LEN_BYTES - 1 - idx];
+    }
+  }
+};
+
+/**************************************************************
+                            Sensor
+***************************************************************/
+/*!
+ * @brief DS18B20 device with a compile-time bus and ROM.
+ */
+template <typename B, typename R>
+struct Sensor
+{
+  typedef B bus;
+  typedef R rom;
+
+  /*!
+   * @brief Starts a conversion on this device only.
+   * @return bool
+   */
+  static bool convert()
+  {
+    bool err = !B::reset();
+
+    if (!err)
+    {
+      R::template match<B>();
+      B::template send<CONVERT_TEMP_CMD>();
+    }
+
+    return err;
+  }
+
+  /*!
+   * @brief Reads the raw temperature register. Does not start
+   * a conversion. The raw value is in units of 1/16 degrees
+   * Celsius.
+   * @param[out] raw Raw signed temperature reading.
+   * @return bool
+   */
+  static bool read_raw(int16_t &raw)
+  {
+    bool err = !B::reset();
+    uint8_t idx;
+    uint8_t crc = 0;
+    uint8_t scratchpad[SCRATCHPAD_LEN_BYTES];
+
+    if (!err)
+    {
+      R::template match<B>();
+      B::template send<READ_SCRATCHPAD_CMD>();
+
+      for (idx = 0; idx < SCRATCHPAD_LEN_BYTES; idx++)
+      {
+        scratchpad[idx] = B::recv_byte();
+      }
+
+      //complete transaction
+      B::reset();
+
+      for (idx = 0; idx < EXPECTED_CRC_IDX; idx++)
+      {
+        crc = crc8(scratchpad[idx], crc);
+      }
+
+      err = (crc != scratchpad[EXPECTED_CRC_IDX]);
+    }
+
+    if (!err)
+    {
+      raw = (int16_t)((scratchpad[TEMP_HI_IDX] << 8) | scratchpad[TEMP_LO_IDX]);
+    }
+
+    return err;
+  }
+
+  /*!
+   * @brief Starts a conversion, waits and reads the result.
+   * @param[out] raw Raw signed temperature reading.
+   * @return bool
+   */
+  static bool read_temp(int16_t &raw)
+  {
+    bool err = convert();
+
+    if (!err)
+    {
+      while (B::is_busy());
+      err = read_raw(raw);
+    }
+
+    return err;
+  }
+};
+
+/**************************************************************
+                            Sweep
+***************************************************************/
+namespace detail {
+
+/*
+ * Schedule generated from the sensor list. Conversions are
+ * broadcast with SKIP ROM once per distinct bus (at the last
+ * sensor of each bus in the list), all buses convert in
+ * parallel, then each sensor is read back in list order.
+ */
+template <typename... Sensors> struct Schedule;
+
+template <> struct Schedule<>
+{
+  static bool convert()           { return false; }
+  static void wait()              {}
+  static bool read(int16_t *raw)  { (void)raw; return false; }
+};
+
+template <typename S, typename... Rest>
+struct Schedule<S, Rest...>
+{
+  typedef typename S::bus B;
+  static const bool last_of_bus = !UsesBus<B, Rest...>::value;
+
+  static bool convert()
+  {
+    bool err = convert_bus(BitTag<last_of_bus>());
+    return Schedule<Rest...>::convert() || err;
+  }
+
+  static void wait()
+  {
+    wait_bus(BitTag<last_of_bus>());
+    Schedule<Rest...>::wait();
+  }
+
+  static bool read(int16_t *raw)
+  {
+    bool err = S::read_raw(*raw);
+    return Schedule<Rest...>::read(raw + 1) || err;
+  }
+
+private:
+  static bool convert_bus(BitTag<true>)
+  {
+    bool err = !B::reset();
+
+    if (!err)
+    {
+      B::template send<SKIP_ROM_CMD, CONVERT_TEMP_CMD>();
+    }
+
+    return err;
+  }
+
+  static bool convert_bus(BitTag<false>) { return false; }
+
+  static void wait_bus(BitTag<true>)
+  {
+    while (B::is_busy());
+  }
+
+  static void wait_bus(BitTag<false>) {}
+};
+
+} /* namespace detail */
+
+/*!
+ * @brief Convert-all/read-each sweep over a compile-time list of
+ * sensors, which may span several buses.
+ */
+template <typename... Sensors>
+struct Sweep
+{
+  static const uint8_t count = sizeof...(Sensors);
+
+  /*!
+   * @brief Runs one sweep. Readings are stored in list order.
+   * Returns Boolean true if any bus or sensor failed.
+   * @param[out] raw One raw reading per sensor.
+   * @return bool
+   */
+  static bool run(int16_t (&raw)[sizeof...(Sensors)])
+  {
+    bool err = detail::Schedule<Sensors...>::convert();
+
+    detail::Schedule<Sensors...>::wait();
+
+    return detail::Schedule<Sensors...>::read(raw) || err;
+  }
+};
+
+} /* namespace ds18b20 */
+
+#endif /* _DS18B20_HPP */
@@ -0,0 +1,168 @@
+/***************************************************************
+ * @file ds18b20_filter.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Incremental fixed-point filtering of raw DS18B20
+ * readings with change-only reporting. Uses integer arithmetic
+ * only so it is cheap enough to run on every reading.
+ *
+ **************************************************************/
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_filter.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                          Macros
+***************************************************************/
+/*
+ * Fractional bits kept by the EWMA accumulator. Two more than the
+ * shift, so a rising input stalls less than a quarter raw unit
+ * short of its target and still rounds onto it.
+ */
+#define EWMA_FRAC_BITS (DS18B20_FILTER_EWMA_SHIFT + 2)
+
+//one raw unit and half a raw unit in accumulator scale
+#define EWMA_ONE  ((int32_t)1 << EWMA_FRAC_BITS)
+#define EWMA_HALF ((int32_t)1 << (EWMA_FRAC_BITS - 1))
+
+//the median is taken from the middle of a small sorted window
+#if ((DS18B20_FILTER_MEDIAN_N % 2) == 0) || (DS18B20_FILTER_MEDIAN_N > 7)
+#error "DS18B20_FILTER_MEDIAN_N must be odd and no more than 7"
+#endif
+
+//a raw reading scaled by the fractional bits must fit the accumulator
+#if (DS18B20_FILTER_EWMA_SHIFT < 0) || (DS18B20_FILTER_EWMA_SHIFT > 14)
+#error "DS18B20_FILTER_EWMA_SHIFT must be between 0 and 14"
+#endif
+
+/**************************************************************
+                    Private Function Prototypes
+***************************************************************/
+static int16_t window_median(ds18b20_filter_t *filter);
+
+/*!
+ * @brief Returns the median of the readings in the window.
+ * @param[in] filter Pointer to filter state.
+ * @return int16_t
+ */
+static int16_t window_median(ds18b20_filter_t *filter)
+{
+  int16_t sorted[DS18B20_FILTER_MEDIAN_N];
+  int16_t value;
+  uint8_t idx;
+  int8_t pos;
+
+  //insertion sort, the window holds at most a handful of samples
+  for (idx = 0; idx < filter->window_len; idx++)
+  {
+    value = filter->window[idx];
+
+    for (pos = idx - 1; (pos >= 0) && (sorted[pos] > value); pos--)
+    {
+      sorted[pos + 1] = sorted[pos];
+    }
+
+    sorted[pos + 1] = value;
+  }
+
+  return sorted[filter->window_len >> 1];
+}
+
+/**************************************************************
+                    Public Functions
+***************************************************************/
+//See DS18B20_filter.h
+void ds18b20_filter_init(ds18b20_filter_t *filter)
+{
+  filter->window_idx = 0;
+  filter->window_len = 0;
+  filter->ewma = 0;
+  filter->value = 0;
+  filter->rate = 0;
+  filter->published = 0;
+  filter->since_publish = 0;
+  filter->primed = false;
+}
+
+//See DS18B20_filter.h
+bool ds18b20_filter_update(ds18b20_filter_t *filter, int16_t raw)
+{
+  bool publish = false;
+  int16_t median;
+  int16_t value;
+  int16_t delta;
+
+  //median-of-N rejects single sample spikes
+  filter->window[filter->window_idx] = raw;
+
+  if (++filter->window_idx == DS18B20_FILTER_MEDIAN_N)
+  {
+    filter->window_idx = 0;
+  }
+
+  if (filter->window_len < DS18B20_FILTER_MEDIAN_N)
+  {
+    filter->window_len++;
+  }
+
+  median = window_median(filter);
+
+  if (!filter->primed)
+  {
+    //seed the average with the first reading
+    filter->ewma = (int32_t)median * EWMA_ONE;
+    value = median;
+  }
+
+  else
+  {
+    //multiply rather than shift, readings below zero are negative
+    filter->ewma += (((int32_t)median * EWMA_ONE) - filter->ewma) >>
+                    DS18B20_FILTER_EWMA_SHIFT;
+    //round to the nearest raw unit
+    value = (int16_t)((filter->ewma + EWMA_HALF) >> EWMA_FRAC_BITS);
+  }
+
+  filter->rate = filter->primed ? (value - filter->value) : 0;
+  filter->value = value;
+
+  //deadband around the last reported value
+  delta = value - filter->published;
+
+  if (!filter->primed ||
+      (delta >= DS18B20_FILTER_DEADBAND) ||
+      (delta <= -DS18B20_FILTER_DEADBAND) ||
+      ((DS18B20_FILTER_HEARTBEAT > 0) &&
+       (filter->since_publish + 1 >= DS18B20_FILTER_HEARTBEAT)))
+  {
+    publish = true;
+    filter->published = value;
+    filter->since_publish = 0;
+  }
+
+  else
+  {
+    filter->since_publish++;
+  }
+
+  filter->primed = true;
+
+  return publish;
+}
+
+//See DS18B20_filter.h
+int16_t ds18b20_filter_value(ds18b20_filter_t *filter)
+{
+  return filter->value;
+}
+
+//See DS18B20_filter.h
+int16_t ds18b20_filter_rate(ds18b20_filter_t *filter)
+{
+  return filter->rate;
+}
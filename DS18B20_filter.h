@@ -0,0 +1,107 @@
+/***************************************************************
+ * @file ds18b20_filter.h
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Incremental fixed-point filtering of raw DS18B20
+ * readings with change-only reporting. Each reading passes a
+ * median-of-N spike filter and an exponentially weighted moving
+ * average, and the rate of change is tracked per sample. A
+ * reading is only reported when it moves outside a deadband
+ * around the last reported value, or when a heartbeat is due.
+ *
+ * All values are raw readings in units of 1/16 degrees Celsius.
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_FILTER_H
+#define _DS18B20_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                           Macros
+***************************************************************/
+//samples in the median window, odd and no more than 7
+#ifndef DS18B20_FILTER_MEDIAN_N
+#define DS18B20_FILTER_MEDIAN_N 3
+#endif
+
+//EWMA smoothing factor is 1 / 2^DS18B20_FILTER_EWMA_SHIFT, at most 14
+#ifndef DS18B20_FILTER_EWMA_SHIFT
+#define DS18B20_FILTER_EWMA_SHIFT 2
+#endif
+
+//smallest change in raw units that is reported (2 = 0.125 C)
+#ifndef DS18B20_FILTER_DEADBAND
+#define DS18B20_FILTER_DEADBAND 2
+#endif
+
+//report at least every this many samples, 0 disables
+#ifndef DS18B20_FILTER_HEARTBEAT
+#define DS18B20_FILTER_HEARTBEAT 30
+#endif
+
+/**************************************************************
+                          Typedefs
+***************************************************************/
+typedef struct {
+  int16_t  window[DS18B20_FILTER_MEDIAN_N];
+  uint8_t  window_idx;
+  uint8_t  window_len;
+  int32_t  ewma;
+  int16_t  value;
+  int16_t  rate;
+  int16_t  published;
+  uint8_t  since_publish;
+  bool     primed;
+} ds18b20_filter_t;
+
+/**************************************************************
+                       Public Functions
+***************************************************************/
+/*!
+ * @brief Resets the filter. The next reading seeds the filter
+ * and is always reported.
+ * @param[in] filter Pointer to filter state.
+ * @return None.
+ */
+void ds18b20_filter_init(ds18b20_filter_t *filter);
+
+/*!
+ * @brief Feeds a raw reading through the filter. Returns Boolean
+ * true if the filtered value should be reported.
+ * @param[in] filter Pointer to filter state.
+ * @param[in] raw Raw signed temperature reading.
+ * @return bool
+ */
+bool ds18b20_filter_update(ds18b20_filter_t *filter, int16_t raw);
+
+/*!
+ * @brief Returns the filtered value in raw units.
+ * @param[in] filter Pointer to filter state.
+ * @return int16_t
+ */
+int16_t ds18b20_filter_value(ds18b20_filter_t *filter);
+
+/*!
+ * @brief Returns the change of the filtered value over the last
+ * sample in raw units.
+ * @param[in] filter Pointer to filter state.
+ * @return int16_t
+ */
+int16_t ds18b20_filter_rate(ds18b20_filter_t *filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DS18B20_FILTER_H */
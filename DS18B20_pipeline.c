@@ -0,0 +1,266 @@
+/***************************************************************
+ * @file ds18b20_pipeline.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Pipelined sweeps across several OWI buses. Buses are
+ * polled for completion with one read slot each, so a finished
+ * bus is picked up within a pass over the others. Staggering
+ * between buses follows naturally from the readout time of each.
+ * A bus without presence is taken out of the rotation and only
+ * probed now and then, so a cut cable neither floods the error
+ * counter nor costs a reset on every pass.
+ *
+ **************************************************************/
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_pipeline.h"
+#include "DS18B20.h"
+#include "DS18B20_table.h"
+#include "owi.h"
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**************************************************************
+                          Macros
+***************************************************************/
+//countdown between retries is held in a byte
+#if (DS18B20_PIPELINE_RETRY_PASSES < 1) || (DS18B20_PIPELINE_RETRY_PASSES > 255)
+#error "DS18B20_PIPELINE_RETRY_PASSES must be between 1 and 255"
+#endif
+
+/**************************************************************
+                    Private Function Prototypes
+***************************************************************/
+static uint8_t count_readout(ds18b20_pipeline_t *pipe, ds18b20_table_t *table);
+static void mark_down(ds18b20_pipeline_t *pipe, uint8_t bus, uint8_t counted);
+
+/*!
+ * @brief Adds the outcome of a bus readout to the counters and
+ * returns the number of devices that failed.
+ * @param[in] pipe Pointer to pipeline.
+ * @param[in] table Pointer to device table just read out.
+ * @return uint8_t
+ */
+static uint8_t count_readout(ds18b20_pipeline_t *pipe, ds18b20_table_t *table)
+{
+  uint8_t idx;
+  uint8_t failed = 0;
+
+  for (idx = 0; idx < table->count; idx++)
+  {
+    if (DS18B20_GET_FLAG(table->valid, idx))
+    {
+      pipe->samples++;
+    }
+
+    else
+    {
+      pipe->errors++;
+      failed++;
+    }
+  }
+
+  return failed;
+}
+
+/*!
+ * @brief Records a failed conversion start. The devices of the
+ * bus are invalidated and counted as errors only when the bus
+ * goes down, not on every retry while it stays down. Devices
+ * whose readout already failed in the same pass are not counted
+ * again.
+ * @param[in] pipe Pointer to pipeline.
+ * @param[in] bus Index of the bus in the pipeline.
+ * @param[in] counted Errors already counted for the bus this pass.
+ * @return None.
+ */
+static void mark_down(ds18b20_pipeline_t *pipe, uint8_t bus, uint8_t counted)
+{
+  uint8_t idx;
+  ds18b20_table_t *table = pipe->tables[bus];
+
+  if (!(pipe->down & _BV(bus)))
+  {
+    for (idx = 0; idx < table->count; idx++)
+    {
+      DS18B20_CLR_FLAG(table->valid, idx);
+      DS18B20_SET_FLAG(table->error, idx);
+    }
+
+    pipe->errors += table->count - counted;
+    pipe->down |= _BV(bus);
+  }
+
+  pipe->retry[bus] = DS18B20_PIPELINE_RETRY_PASSES;
+}
+
+/**************************************************************
+                    Public Functions
+***************************************************************/
+//See DS18B20_pipeline.h
+void ds18b20_pipeline_init(ds18b20_pipeline_t *pipe)
+{
+  uint8_t bus;
+
+  pipe->count = 0;
+  pipe->converting = 0;
+  pipe->down = 0;
+
+  for (bus = 0; bus < DS18B20_PIPELINE_MAX_BUSES; bus++)
+  {
+    pipe->retry[bus] = 0;
+  }
+
+  ds18b20_pipeline_reset_stats(pipe);
+}
+
+//See DS18B20_pipeline.h
+bool ds18b20_pipeline_add(ds18b20_pipeline_t *pipe, ds18b20_table_t *table)
+{
+  bool err = false;
+
+  if ((table == NULL) || (pipe->count >= DS18B20_PIPELINE_MAX_BUSES))
+  {
+    err = true;
+  }
+
+  if (!err)
+  {
+    pipe->tables[pipe->count++] = table;
+  }
+
+  return err;
+}
+
+//See DS18B20_pipeline.h
+uint8_t ds18b20_pipeline_service(ds18b20_pipeline_t *pipe)
+{
+  uint8_t bus;
+  uint8_t done = 0;
+  uint8_t failed;
+  ds18b20_table_t *table;
+
+  for (bus = 0; bus < pipe->count; bus++)
+  {
+    table = pipe->tables[bus];
+    failed = 0;
+
+    if (pipe->converting & _BV(bus))
+    {
+      //one read slot tells whether the bus is still converting
+      if (owi_is_busy(table->pin))
+      {
+        continue;
+      }
+
+      ds18b20_table_readout(table);
+      failed = count_readout(pipe, table);
+      pipe->converting &= ~_BV(bus);
+      done |= _BV(bus);
+    }
+
+    //a bus that is down sits out passes between retries
+    else if ((pipe->down & _BV(bus)) && (pipe->retry[bus] > 0))
+    {
+      pipe->retry[bus]--;
+      done |= _BV(bus);
+      continue;
+    }
+
+    //start the next conversion right away
+    if (!ds18b20_start_convert_all(table->pin))
+    {
+      pipe->converting |= _BV(bus);
+      pipe->down &= ~_BV(bus);
+    }
+
+    else
+    {
+      mark_down(pipe, bus, failed);
+      done |= _BV(bus);
+    }
+  }
+
+  return done;
+}
+
+//See DS18B20_pipeline.h
+bool ds18b20_pipeline_sweep(ds18b20_pipeline_t *pipe)
+{
+  uint8_t done = 0;
+  uint8_t all;
+  uint32_t errors = pipe->errors;
+
+  all = (uint8_t)((1 << pipe->count) - 1);
+
+  while ((done & all) != all)
+  {
+    done |= ds18b20_pipeline_service(pipe);
+  }
+
+  return ((pipe->errors != errors) || (pipe->down & all));
+}
+
+//See DS18B20_pipeline.h
+bool ds18b20_pipeline_is_down(ds18b20_pipeline_t *pipe, uint8_t bus)
+{
+  return ((pipe->down & _BV(bus)) != 0);
+}
+
+//See DS18B20_pipeline.h
+void ds18b20_pipeline_reset_stats(ds18b20_pipeline_t *pipe)
+{
+  pipe->samples = 0;
+  pipe->errors = 0;
+}
+
+//See DS18B20_pipeline.h
+float ds18b20_pipeline_achieved_sps(ds18b20_pipeline_t *pipe, uint32_t elapsed_ms)
+{
+  float sps = 0;
+
+  if (elapsed_ms > 0)
+  {
+    sps = ((float)pipe->samples * 1000.0F) / (float)elapsed_ms;
+  }
+
+  return sps;
+}
+
+//See DS18B20_pipeline.h
+float ds18b20_pipeline_bound_sps(ds18b20_pipeline_t *pipe)
+{
+  uint8_t bus;
+  uint16_t devices = 0;
+  float bus_us;
+  float cpu_us = 0;
+  float bus_sps = 0;
+  float cpu_sps = 0;
+
+  for (bus = 0; bus < pipe->count; bus++)
+  {
+    //bit-banging time of one cycle on this bus
+    bus_us = DS18B20_CONVERT_ALL_US +
+             ((float)pipe->tables[bus]->count * DS18B20_READOUT_US);
+
+    //each bus cycles through conversion, start and readout
+    bus_sps += ((float)pipe->tables[bus]->count * 1e6F) /
+               ((DS18B20_CONVERSION_MS * 1000.0F) + bus_us);
+
+    cpu_us += bus_us;
+    devices += pipe->tables[bus]->count;
+  }
+
+  if (cpu_us > 0)
+  {
+    //the CPU serves one bus at a time
+    cpu_sps = ((float)devices * 1e6F) / cpu_us;
+  }
+
+  return (bus_sps < cpu_sps) ? bus_sps : cpu_sps;
+}
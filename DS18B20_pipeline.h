@@ -0,0 +1,133 @@
+/***************************************************************
+ * @file ds18b20_pipeline.h
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Pipelined sweeps across several OWI buses. Each bus is
+ * a device table on its own pin of the OWI port. Conversions run
+ * on all buses in parallel; as soon as one bus finishes it is
+ * read out and its next conversion is started, so the readout of
+ * one bus overlaps the conversions of the others.
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_PIPELINE_H
+#define _DS18B20_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_table.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                           Macros
+***************************************************************/
+//one bus per pin of the OWI port
+#define DS18B20_PIPELINE_MAX_BUSES 8
+
+//passes skipped between start attempts on a bus that is down (1-255)
+#ifndef DS18B20_PIPELINE_RETRY_PASSES
+#define DS18B20_PIPELINE_RETRY_PASSES 64
+#endif
+
+/**************************************************************
+                          Typedefs
+***************************************************************/
+typedef struct {
+  ds18b20_table_t *tables[DS18B20_PIPELINE_MAX_BUSES];
+  uint8_t  count;
+  uint8_t  converting;
+  uint8_t  down;
+  uint8_t  retry[DS18B20_PIPELINE_MAX_BUSES];
+  uint32_t samples;
+  uint32_t errors;
+} ds18b20_pipeline_t;
+
+/**************************************************************
+                       Public Functions
+***************************************************************/
+/*!
+ * @brief Initializes an empty pipeline.
+ * @param[in] pipe Pointer to pipeline.
+ * @return None.
+ */
+void ds18b20_pipeline_init(ds18b20_pipeline_t *pipe);
+
+/*!
+ * @brief Adds a bus to the pipeline. The table must already be
+ * populated. Returns Boolean true if the pipeline is full.
+ * @param[in] pipe Pointer to pipeline.
+ * @param[in] table Pointer to device table of the bus.
+ * @return bool
+ */
+bool ds18b20_pipeline_add(ds18b20_pipeline_t *pipe, ds18b20_table_t *table);
+
+/*!
+ * @brief Makes one pass over all buses. Idle buses get a
+ * conversion started; a converting bus is polled with a single
+ * read slot and, once finished, read out and restarted. A bus
+ * whose conversion cannot be started is marked down, its devices
+ * are counted as errors once, and a start is only retried every
+ * DS18B20_PIPELINE_RETRY_PASSES passes until it answers again.
+ * Returns a mask with the bit of every bus read out or down
+ * during this pass.
+ * @param[in] pipe Pointer to pipeline.
+ * @return uint8_t
+ */
+uint8_t ds18b20_pipeline_service(ds18b20_pipeline_t *pipe);
+
+/*!
+ * @brief Services the pipeline until every bus has been read out
+ * once or is down. Returns Boolean true if any device failed or
+ * any bus is down.
+ * @param[in] pipe Pointer to pipeline.
+ * @return bool
+ */
+bool ds18b20_pipeline_sweep(ds18b20_pipeline_t *pipe);
+
+/*!
+ * @brief Returns Boolean true if the bus could not start its last
+ * conversion and has not answered since.
+ * @param[in] pipe Pointer to pipeline.
+ * @param[in] bus Index of the bus in the pipeline.
+ * @return bool
+ */
+bool ds18b20_pipeline_is_down(ds18b20_pipeline_t *pipe, uint8_t bus);
+
+/*!
+ * @brief Clears the sample and error counters.
+ * @param[in] pipe Pointer to pipeline.
+ * @return None.
+ */
+void ds18b20_pipeline_reset_stats(ds18b20_pipeline_t *pipe);
+
+/*!
+ * @brief Returns the samples per second achieved since the
+ * counters were last cleared.
+ * @param[in] pipe Pointer to pipeline.
+ * @param[in] elapsed_ms Time since the counters were cleared.
+ * @return float
+ */
+float ds18b20_pipeline_achieved_sps(ds18b20_pipeline_t *pipe, uint32_t elapsed_ms);
+
+/*!
+ * @brief Returns the upper bound on samples per second for the
+ * buses in the pipeline. Each bus can do no better than one
+ * conversion, start and readout per cycle, and the CPU can do no
+ * better than bit-banging every start and readout back to back.
+ * @param[in] pipe Pointer to pipeline.
+ * @return float
+ */
+float ds18b20_pipeline_bound_sps(ds18b20_pipeline_t *pipe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DS18B20_PIPELINE_H */
@@ -0,0 +1,255 @@
+/***************************************************************
+ * @file ds18b20_policy.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Retry and bus-health policy for DS18B20 device tables.
+ * Intended for long cable runs where single readouts fail now
+ * and then. A conversion takes up to 750 ms, so a failed
+ * readout is retried on its own rather than wasting the whole
+ * conversion.
+ *
+ **************************************************************/
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_policy.h"
+#include "DS18B20.h"
+#include "DS18B20_table.h"
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+//CPU frequency required for util library
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#include <util/delay.h>
+
+/**************************************************************
+                          Macros
+***************************************************************/
+//doubling the delay must not overflow its 16-bit counter
+#if DS18B20_POLICY_BACKOFF_MAX_MS > 0x8000
+#error "DS18B20_POLICY_BACKOFF_MAX_MS must not exceed 32768"
+#endif
+
+/**************************************************************
+                    Private Function Prototypes
+***************************************************************/
+static void backoff_delay(uint16_t ms);
+static ds18b20_status_t readout_retry(ds18b20_table_t *table, uint8_t idx,
+                                      uint8_t retries);
+static void update_health(ds18b20_health_t *health, uint8_t idx,
+                          ds18b20_status_t status);
+
+/*!
+ * @brief Busy waits for the given number of milliseconds.
+ * @param[in] ms Delay in milliseconds.
+ * @return None.
+ */
+static void backoff_delay(uint16_t ms)
+{
+  //util delay requires a compile-time constant
+  while (ms--)
+  {
+    _delay_ms(1);
+  }
+}
+
+/*!
+ * @brief Reads a device back, retrying presence and CRC
+ * failures with a doubling delay between attempts.
+ * @param[in] table Pointer to device table.
+ * @param[in] idx Table index of device.
+ * @param[in] retries Maximum number of retries.
+ * @return ds18b20_status_t
+ */
+static ds18b20_status_t readout_retry(ds18b20_table_t *table, uint8_t idx,
+                                      uint8_t retries)
+{
+  ds18b20_status_t status;
+  uint16_t backoff = DS18B20_POLICY_BACKOFF_MS;
+  uint8_t rom[DS18B20_ROM_LEN_BYTES];
+
+  ds18b20_table_get_rom(table, idx, rom);
+  status = ds18b20_readout(rom, table->pin, &table->raw[idx]);
+
+  while (((status == DS18B20_ERR_PRESENCE) || (status == DS18B20_ERR_CRC)) &&
+         (retries > 0))
+  {
+    backoff_delay(backoff);
+
+    if (backoff < DS18B20_POLICY_BACKOFF_MAX_MS)
+    {
+      backoff <<= 1;
+
+      if (backoff > DS18B20_POLICY_BACKOFF_MAX_MS)
+      {
+        backoff = DS18B20_POLICY_BACKOFF_MAX_MS;
+      }
+    }
+
+    status = ds18b20_readout(rom, table->pin, &table->raw[idx]);
+    retries--;
+  }
+
+  return status;
+}
+
+/*!
+ * @brief Adjusts the health score of a device after a readout
+ * and moves it in or out of quarantine. A power-on reading means
+ * the conversion did not run, which is not a fault of the readout,
+ * so it leaves the score alone.
+ * @param[in] health Pointer to health state.
+ * @param[in] idx Table index of device.
+ * @param[in] status Outcome of the readout.
+ * @return None.
+ */
+static void update_health(ds18b20_health_t *health, uint8_t idx,
+                          ds18b20_status_t status)
+{
+  health->status[idx] = status;
+
+  if (status == DS18B20_OK)
+  {
+    if (DS18B20_GET_FLAG(health->quarantined, idx))
+    {
+      //probe passed, restore just above the quarantine line
+      DS18B20_CLR_FLAG(health->quarantined, idx);
+      health->score[idx] = DS18B20_HEALTH_QUARANTINE + DS18B20_HEALTH_REWARD;
+    }
+
+    else if (health->score[idx] > (DS18B20_HEALTH_MAX - DS18B20_HEALTH_REWARD))
+    {
+      health->score[idx] = DS18B20_HEALTH_MAX;
+    }
+
+    else
+    {
+      health->score[idx] += DS18B20_HEALTH_REWARD;
+    }
+  }
+
+  //a conversion that did not run is not held against the device
+  else if (status != DS18B20_ERR_POWER_ON)
+  {
+    if (health->score[idx] > DS18B20_HEALTH_PENALTY)
+    {
+      health->score[idx] -= DS18B20_HEALTH_PENALTY;
+    }
+
+    else
+    {
+      health->score[idx] = 0;
+    }
+
+    if (health->score[idx] <= DS18B20_HEALTH_QUARANTINE)
+    {
+      DS18B20_SET_FLAG(health->quarantined, idx);
+      health->holdoff[idx] = DS18B20_QUARANTINE_SWEEPS;
+    }
+  }
+}
+
+/**************************************************************
+                    Public Functions
+***************************************************************/
+//See DS18B20_policy.h
+void ds18b20_health_init(ds18b20_health_t *health)
+{
+  uint8_t idx;
+
+  for (idx = 0; idx < DS18B20_TABLE_MAX_DEVS; idx++)
+  {
+    health->score[idx] = DS18B20_HEALTH_MAX;
+    health->holdoff[idx] = 0;
+    health->status[idx] = DS18B20_OK;
+  }
+
+  for (idx = 0; idx < DS18B20_TABLE_FLAG_BYTES; idx++)
+  {
+    health->quarantined[idx] = 0;
+  }
+}
+
+//See DS18B20_policy.h
+bool ds18b20_policy_sweep(ds18b20_table_t *table, ds18b20_health_t *health)
+{
+  bool err = false;
+  bool bus_err;
+  uint8_t idx;
+  uint8_t retries;
+  ds18b20_status_t status;
+
+  //one broadcast conversion for the whole bus
+  bus_err = ds18b20_convert_all(table->pin);
+
+  for (idx = 0; idx < table->count; idx++)
+  {
+    retries = DS18B20_POLICY_MAX_RETRIES;
+
+    if (DS18B20_GET_FLAG(health->quarantined, idx))
+    {
+      //sit out the sweep while the holdoff lasts
+      if (health->holdoff[idx] > 0)
+      {
+        health->holdoff[idx]--;
+        DS18B20_CLR_FLAG(table->valid, idx);
+        DS18B20_SET_FLAG(table->error, idx);
+        err = true;
+        continue;
+      }
+
+      //single probe readout once the holdoff expires
+      retries = 0;
+    }
+
+    if (bus_err)
+    {
+      //nothing answered the reset, not a fault of this device
+      status = DS18B20_ERR_PRESENCE;
+      health->status[idx] = status;
+    }
+
+    else
+    {
+      status = readout_retry(table, idx, retries);
+      update_health(health, idx, status);
+    }
+
+    if (status == DS18B20_OK)
+    {
+      DS18B20_SET_FLAG(table->valid, idx);
+      DS18B20_CLR_FLAG(table->error, idx);
+    }
+
+    else
+    {
+      DS18B20_CLR_FLAG(table->valid, idx);
+      DS18B20_SET_FLAG(table->error, idx);
+      err = true;
+    }
+  }
+
+  return err;
+}
+
+//See DS18B20_policy.h
+uint8_t ds18b20_health_score(ds18b20_health_t *health, uint8_t idx)
+{
+  return health->score[idx];
+}
+
+//See DS18B20_policy.h
+bool ds18b20_health_is_quarantined(ds18b20_health_t *health, uint8_t idx)
+{
+  return DS18B20_GET_FLAG(health->quarantined, idx);
+}
+
+//See DS18B20_policy.h
+ds18b20_status_t ds18b20_health_status(ds18b20_health_t *health, uint8_t idx)
+{
+  return (ds18b20_status_t)health->status[idx];
+}
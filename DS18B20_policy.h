@@ -0,0 +1,125 @@
+/***************************************************************
+ * @file ds18b20_policy.h
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Retry and bus-health policy for DS18B20 device tables.
+ * Failed readouts are retried with bounded backoff without
+ * repeating the conversion. Each device carries a health score;
+ * devices whose score drops too low are quarantined and only
+ * probed once every few sweeps.
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_POLICY_H
+#define _DS18B20_POLICY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20.h"
+#include "DS18B20_table.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                           Macros
+***************************************************************/
+//readout attempts after the first one fails
+#ifndef DS18B20_POLICY_MAX_RETRIES
+#define DS18B20_POLICY_MAX_RETRIES 3
+#endif
+
+//delay before the first retry, doubled on each further retry
+#ifndef DS18B20_POLICY_BACKOFF_MS
+#define DS18B20_POLICY_BACKOFF_MS 1
+#endif
+
+//upper bound of the retry delay
+#ifndef DS18B20_POLICY_BACKOFF_MAX_MS
+#define DS18B20_POLICY_BACKOFF_MAX_MS 8
+#endif
+
+//health score range and adjustments
+#define DS18B20_HEALTH_MAX 100
+#define DS18B20_HEALTH_REWARD 5
+#define DS18B20_HEALTH_PENALTY 20
+
+//score at or below which a device is quarantined
+#ifndef DS18B20_HEALTH_QUARANTINE
+#define DS18B20_HEALTH_QUARANTINE 40
+#endif
+
+//sweeps a quarantined device sits out before it is probed again
+#ifndef DS18B20_QUARANTINE_SWEEPS
+#define DS18B20_QUARANTINE_SWEEPS 16
+#endif
+
+/**************************************************************
+                          Typedefs
+***************************************************************/
+typedef struct {
+  uint8_t  score[DS18B20_TABLE_MAX_DEVS];
+  uint8_t  holdoff[DS18B20_TABLE_MAX_DEVS];
+  uint8_t  status[DS18B20_TABLE_MAX_DEVS];
+  uint8_t  quarantined[DS18B20_TABLE_FLAG_BYTES];
+} ds18b20_health_t;
+
+/**************************************************************
+                       Public Functions
+***************************************************************/
+/*!
+ * @brief Marks every device healthy and out of quarantine.
+ * @param[in] health Pointer to health state.
+ * @return None.
+ */
+void ds18b20_health_init(ds18b20_health_t *health);
+
+/*!
+ * @brief Starts a conversion on every device at once and reads
+ * back each device that is not quarantined, retrying failed
+ * readouts. Presence and CRC failures are retried; a power-on
+ * reading means the conversion did not run; it is not retried
+ * and does not count against the health score.
+ * Table flags and health state are updated. Returns Boolean
+ * true if any device failed or was skipped.
+ * @param[in] table Pointer to device table.
+ * @param[in] health Pointer to health state.
+ * @return bool
+ */
+bool ds18b20_policy_sweep(ds18b20_table_t *table, ds18b20_health_t *health);
+
+/*!
+ * @brief Returns the health score of a device, from zero up to
+ * DS18B20_HEALTH_MAX.
+ * @param[in] health Pointer to health state.
+ * @param[in] idx Table index of device.
+ * @return uint8_t
+ */
+uint8_t ds18b20_health_score(ds18b20_health_t *health, uint8_t idx);
+
+/*!
+ * @brief Indicates whether a device is quarantined.
+ * @param[in] health Pointer to health state.
+ * @param[in] idx Table index of device.
+ * @return bool
+ */
+bool ds18b20_health_is_quarantined(ds18b20_health_t *health, uint8_t idx);
+
+/*!
+ * @brief Returns the outcome of the last readout of a device.
+ * @param[in] health Pointer to health state.
+ * @param[in] idx Table index of device.
+ * @return ds18b20_status_t
+ */
+ds18b20_status_t ds18b20_health_status(ds18b20_health_t *health, uint8_t idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DS18B20_POLICY_H */
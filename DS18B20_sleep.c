@@ -0,0 +1,345 @@
+/***************************************************************
+ * @file ds18b20_sleep.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Low power DS18B20 readings for battery powered nodes.
+ * The watchdog timer is run in interrupt mode to wake the AVR
+ * after each sleep period. Since the watchdog oscillator is not
+ * precise, the bus is polled after waking until the conversion
+ * reports completion.
+ *
+ * Awake time is measured with Timer1, which runs from the system
+ * clock and halts in power-down, extended to 32 bits by counting
+ * overflows. Sleep time is the watchdog periods slept, scaled by
+ * the watchdog period measured against Timer1 in idle mode.
+ *
+ **************************************************************/
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_sleep.h"
+#include "DS18B20.h"
+#include "DS18B20_table.h"
+#include "owi.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+//CPU frequency required to convert timer ticks
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+/**************************************************************
+                          Macros
+***************************************************************/
+#define NUM_WDT_PERIODS 6
+
+//Timer1 runs at F_CPU / 64, 4 us per tick at 16 MHz
+#define TIMER1_PRESCALER 64UL
+#define TIMER1_TICK_US (TIMER1_PRESCALER / (F_CPU / 1000000UL))
+
+#if (TIMER1_PRESCALER % (F_CPU / 1000000UL)) != 0
+#error "F_CPU in MHz must divide the Timer1 prescaler of 64"
+#endif
+
+//watchdog period timed by ds18b20_duty_calibrate()
+#define CAL_PRESCALER WDTO_15MS
+#define CAL_PERIOD_MS 16
+
+/**************************************************************
+                          Variables
+***************************************************************/
+//watchdog periods from longest to shortest
+static const uint8_t wdt_prescaler[NUM_WDT_PERIODS] = {
+  WDTO_500MS, WDTO_250MS, WDTO_120MS, WDTO_60MS, WDTO_30MS, WDTO_15MS
+};
+
+//nominal period in milliseconds for each prescaler above
+static const uint16_t wdt_period_ms[NUM_WDT_PERIODS] = {
+  500, 250, 125, 64, 32, 16
+};
+
+static volatile bool wdt_fired = false;
+static volatile uint16_t timer1_overflows = 0;
+
+/**************************************************************
+                    Private Function Prototypes
+***************************************************************/
+static inline void wdt_write(uint8_t value) __attribute__ ((always_inline));
+static void wdt_sleep(uint8_t prescaler, uint8_t mode);
+static uint32_t timer1_ticks(void);
+static void count_awake(ds18b20_duty_t *duty);
+
+/*!
+ * @brief Watchdog interrupt, wakes the AVR from sleep.
+ */
+ISR(WDT_vect)
+{
+  wdt_fired = true;
+}
+
+/*!
+ * @brief Timer1 overflow, extends the tick count to 32 bits.
+ */
+ISR(TIMER1_OVF_vect)
+{
+  timer1_overflows++;
+}
+
+/*!
+ * @brief Returns the 32-bit Timer1 tick count, including an
+ * overflow that is pending but not yet serviced.
+ * @return uint32_t
+ */
+static uint32_t timer1_ticks(void)
+{
+  uint8_t sreg = SREG;
+  uint16_t count;
+  uint16_t overflows;
+
+  cli();
+  count = TCNT1;
+  overflows = timer1_overflows;
+
+  //the counter wrapped after interrupts were disabled
+  if ((TIFR1 & _BV(TOV1)) && (count < 0x8000))
+  {
+    overflows++;
+  }
+
+  SREG = sreg;
+
+  return ((uint32_t)overflows << 16) | count;
+}
+
+/*!
+ * @brief Adds the Timer1 time since the last mark to the awake
+ * time and moves the mark to now.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return None.
+ */
+static void count_awake(ds18b20_duty_t *duty)
+{
+  uint32_t now = timer1_ticks();
+
+  duty->awake_us += (now - duty->mark) * TIMER1_TICK_US;
+  duty->mark = now;
+}
+
+/*!
+ * @brief Writes the watchdog control register using the timed
+ * change sequence. Both values are loaded into registers first
+ * so the two stores are back to back, well within the four
+ * cycles allowed, as in avr-libc wdt_enable(). Must be called
+ * with interrupts disabled.
+ * @param[in] value New watchdog control register value.
+ * @return None.
+ */
+static inline void wdt_write(uint8_t value)
+{
+  __asm__ __volatile__ (
+    "wdr"         "\n\t"
+    "sts %0, %1"  "\n\t"
+    "sts %0, %2"  "\n\t"
+    :
+    : "n" (_SFR_MEM_ADDR(WDTCSR)),
+      "r" ((uint8_t)(_BV(WDCE) | _BV(WDE))),
+      "r" (value)
+    : "memory"
+  );
+}
+
+/*!
+ * @brief Sleeps until the watchdog fires once with the given
+ * prescaler. Other interrupts waking the AVR early are ignored.
+ * The caller's watchdog configuration is restored afterwards.
+ * @param[in] prescaler Watchdog prescaler (WDTO_xxx).
+ * @param[in] mode Sleep mode (SLEEP_MODE_xxx).
+ * @return None.
+ */
+static void wdt_sleep(uint8_t prescaler, uint8_t mode)
+{
+  uint8_t saved;
+  uint8_t config;
+
+  cli();
+  saved = WDTCSR & ~(_BV(WDIF) | _BV(WDCE));
+
+  /*
+   * Interrupt mode with the requested period. A reset watchdog
+   * enabled by the application stays armed, the interrupt fires
+   * first and the reset only follows if the AVR hangs.
+   */
+  config = _BV(WDIE) | (saved & _BV(WDE)) | (prescaler & 0x07) |
+           ((prescaler & 0x08) ? _BV(WDP3) : 0);
+
+  wdt_fired = false;
+  wdt_write(config);
+
+  set_sleep_mode(mode);
+  sleep_enable();
+
+  while (!wdt_fired)
+  {
+    sei();
+    sleep_cpu();
+    cli();
+  }
+
+  sleep_disable();
+  //hand the watchdog back as the application left it
+  wdt_write(saved);
+  sei();
+}
+
+/**************************************************************
+                    Public Functions
+***************************************************************/
+//See DS18B20_sleep.h
+void ds18b20_duty_reset(ds18b20_duty_t *duty)
+{
+  //free running Timer1, normal mode
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11) | _BV(CS10);
+  TIMSK1 |= _BV(TOIE1);
+
+  duty->sleep_ms = 0;
+  duty->awake_us = 0;
+  duty->wakeups = 0;
+  duty->polls = 0;
+  duty->wdt_us_per_ms = 0;
+  duty->mark = timer1_ticks();
+}
+
+//See DS18B20_sleep.h
+void ds18b20_duty_calibrate(ds18b20_duty_t *duty)
+{
+  uint32_t start;
+  uint32_t ticks;
+
+  count_awake(duty);
+
+  //Timer1 keeps running in idle mode and times the watchdog
+  start = timer1_ticks();
+  wdt_sleep(CAL_PRESCALER, SLEEP_MODE_IDLE);
+  ticks = timer1_ticks() - start;
+
+  duty->wdt_us_per_ms = (uint16_t)((ticks * TIMER1_TICK_US) / CAL_PERIOD_MS);
+  duty->sleep_ms += (ticks * TIMER1_TICK_US + 500) / 1000;
+  duty->mark = timer1_ticks();
+}
+
+//See DS18B20_sleep.h
+uint16_t ds18b20_duty_permille(ds18b20_duty_t *duty)
+{
+  uint32_t awake_ms;
+  uint16_t permille = 0;
+
+  awake_ms = duty->awake_us / 1000;
+
+  if ((awake_ms + duty->sleep_ms) > 0)
+  {
+    permille = (uint16_t)((awake_ms * 1000) / (awake_ms + duty->sleep_ms));
+  }
+
+  return permille;
+}
+
+//See DS18B20_sleep.h
+void ds18b20_sleep_until_converted(uint8_t pin, ds18b20_duty_t *duty)
+{
+  uint8_t idx;
+  uint16_t remaining_ms = DS18B20_CONVERSION_MS;
+
+  if (duty->wdt_us_per_ms == 0)
+  {
+    ds18b20_duty_calibrate(duty);
+  }
+
+  //cover the conversion time with the fewest watchdog periods
+  for (idx = 0; idx < NUM_WDT_PERIODS; idx++)
+  {
+    while (remaining_ms >= wdt_period_ms[idx])
+    {
+      count_awake(duty);
+      wdt_sleep(wdt_prescaler[idx], DS18B20_SLEEP_MODE);
+      //time asleep is not awake time, even if Timer1 kept running
+      duty->mark = timer1_ticks();
+
+      remaining_ms -= wdt_period_ms[idx];
+      duty->sleep_ms += (((uint32_t)wdt_period_ms[idx] * duty->wdt_us_per_ms) +
+                         500) / 1000;
+      duty->wakeups++;
+    }
+  }
+
+  //poll out the remainder and any watchdog inaccuracy
+  while (owi_is_busy(pin))
+  {
+    duty->polls++;
+  }
+
+  count_awake(duty);
+}
+
+//See DS18B20_sleep.h
+bool ds18b20_read_temp_sleep(ds18b20_dev_t *dev, ds18b20_duty_t *duty)
+{
+  bool err = false;
+  int16_t raw_temp = 0;
+
+  err = ds18b20_start_convert(dev->rom, dev->pin);
+
+  if (!err)
+  {
+    ds18b20_sleep_until_converted(dev->pin, duty);
+    err = ds18b20_read_raw(dev->rom, dev->pin, &raw_temp);
+  }
+
+  count_awake(duty);
+
+  if (!err)
+  {
+    dev->raw = raw_temp;
+    //convert to readable format (in Celsius)
+    dev->temp = ((float)raw_temp * DS18B20_PRECISION);
+  }
+
+  return err;
+}
+
+//See DS18B20_sleep.h
+bool ds18b20_table_sweep_sleep(ds18b20_table_t *table, ds18b20_duty_t *duty)
+{
+  bool err = false;
+  uint8_t idx;
+
+  //one broadcast conversion for the whole bus
+  err = ds18b20_start_convert_all(table->pin);
+
+  if (!err)
+  {
+    ds18b20_sleep_until_converted(table->pin, duty);
+    err = ds18b20_table_readout(table);
+  }
+
+  else
+  {
+    //no device answered, invalidate every reading
+    for (idx = 0; idx < table->count; idx++)
+    {
+      DS18B20_CLR_FLAG(table->valid, idx);
+      DS18B20_SET_FLAG(table->error, idx);
+    }
+  }
+
+  count_awake(duty);
+
+  return err;
+}
@@ -0,0 +1,129 @@
+/***************************************************************
+ * @file ds18b20_sleep.h
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Low power DS18B20 readings for battery powered nodes.
+ * Instead of polling the bus for the whole conversion, the AVR
+ * is put to sleep and woken by the watchdog timer once the
+ * conversion time for DS18B20_RESOLUTION_BITS has elapsed.
+ * Awake and sleep time are measured for duty-cycle reporting:
+ * awake time with Timer1, sleep time with the watchdog calibrated
+ * against Timer1. Everything between two sleeps counts as awake,
+ * including the application's own work between readings.
+ *
+ * Timer1 and the watchdog and Timer1 overflow interrupt vectors
+ * are owned by this module. The application's watchdog
+ * configuration is saved before each sleep and restored after it;
+ * a reset watchdog stays armed while asleep, and MCUSR (including
+ * the reset cause) is not touched. While asleep the watchdog runs
+ * with the sleep period and raises its interrupt before it would
+ * reset the AVR. In power-down mode Timer0 is stopped, so Arduino
+ * millis() does not advance while asleep. Start-up time after
+ * waking, set by the clock fuses, passes before Timer1 runs and
+ * is not counted.
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_SLEEP_H
+#define _DS18B20_SLEEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20.h"
+#include "DS18B20_table.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                           Macros
+***************************************************************/
+/*
+ * Sleep mode entered during conversions. The watchdog wakes
+ * the AVR from any mode, SLEEP_MODE_IDLE keeps other timers
+ * running at the cost of a higher current draw.
+ */
+#ifndef DS18B20_SLEEP_MODE
+#define DS18B20_SLEEP_MODE SLEEP_MODE_PWR_DOWN
+#endif
+
+/**************************************************************
+                          Typedefs
+***************************************************************/
+typedef struct {
+  uint32_t sleep_ms;
+  uint32_t awake_us;
+  uint16_t wakeups;
+  uint16_t polls;
+  uint16_t wdt_us_per_ms;
+  uint32_t mark;
+} ds18b20_duty_t;
+
+/**************************************************************
+                       Public Functions
+***************************************************************/
+/*!
+ * @brief Starts Timer1 and clears accumulated duty-cycle
+ * counters. Awake time is counted from this call on. The
+ * watchdog calibration is cleared and redone on the next sleep.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return None.
+ */
+void ds18b20_duty_reset(ds18b20_duty_t *duty);
+
+/*!
+ * @brief Times one 16 ms watchdog period with Timer1 in idle
+ * sleep. Sleep time is scaled by the result. The watchdog
+ * oscillator drifts with supply voltage and temperature, so call
+ * this now and then on long running nodes.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return None.
+ */
+void ds18b20_duty_calibrate(ds18b20_duty_t *duty);
+
+/*!
+ * @brief Returns the fraction of measured time spent awake,
+ * in parts per thousand.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return uint16_t
+ */
+uint16_t ds18b20_duty_permille(ds18b20_duty_t *duty);
+
+/*!
+ * @brief Sleeps for the nominal conversion time and then polls
+ * the bus until the conversion has completed. A conversion must
+ * already be running on the bus.
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return None.
+ */
+void ds18b20_sleep_until_converted(uint8_t pin, ds18b20_duty_t *duty);
+
+/*!
+ * @brief Same as ds18b20_read_temp() but sleeps during the
+ * conversion.
+ * @param[in] dev Pointer to device structure.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return bool
+ */
+bool ds18b20_read_temp_sleep(ds18b20_dev_t *dev, ds18b20_duty_t *duty);
+
+/*!
+ * @brief Same as ds18b20_table_sweep() but sleeps during the
+ * conversion.
+ * @param[in] table Pointer to device table.
+ * @param[in] duty Pointer to duty-cycle counters.
+ * @return bool
+ */
+bool ds18b20_table_sweep_sleep(ds18b20_table_t *table, ds18b20_duty_t *duty);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DS18B20_SLEEP_H */
@@ -0,0 +1,308 @@
+/***************************************************************
+ * @file ds18b20_table.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Compact structure-of-arrays table of DS18B20 devices
+ * sharing a single OWI bus. Keeps per-device SRAM usage to
+ * the serial number, a raw reading and two flag bits so that
+ * large sensor arrays fit on small AVR devices.
+ *
+ **************************************************************/
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20_table.h"
+#include "DS18B20.h"
+#include "owi.h"
+#include "owi_crc.h"
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**************************************************************
+                          Macros
+***************************************************************/
+/*
+ * Fail the build if the advertised footprint drifts from the
+ * real structure size.
+ */
+typedef char table_size_check[
+  (sizeof(ds18b20_table_t) == DS18B20_TABLE_SIZE_BYTES) ? 1 : -1];
+
+/**************************************************************
+                    Private Function Prototypes
+***************************************************************/
+static uint8_t rom_crc(uint8_t *rom);
+
+/*!
+ * @brief Computes the CRC8 of the family code and serial
+ * number of a ROM stored in driver byte order.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @return uint8_t
+ */
+static uint8_t rom_crc(uint8_t *rom)
+{
+  int8_t idx;
+  uint8_t crc = 0;
+
+  //CRC covers bytes in the order they are sent on the bus
+  for (idx = DS18B20_ROM_FAMILY_IDX; idx > DS18B20_ROM_CRC_IDX; idx--)
+  {
+    crc = crc8(rom[idx], crc);
+  }
+
+  return crc;
+}
+
+/**************************************************************
+                    Public Functions
+***************************************************************/
+//See DS18B20_table.h
+bool ds18b20_table_init(ds18b20_table_t *table, uint8_t pin)
+{
+  bool err = false;
+  uint8_t idx;
+
+  if (table == NULL)
+  {
+    err = true;
+  }
+
+  if (!err)
+  {
+    table->pin = pin;
+    table->count = 0;
+
+    for (idx = 0; idx < DS18B20_TABLE_FLAG_BYTES; idx++)
+    {
+      table->valid[idx] = 0;
+      table->error[idx] = 0;
+    }
+
+    owi_init(pin);
+  }
+
+  return err;
+}
+
+//See DS18B20_table.h
+uint8_t ds18b20_table_add(ds18b20_table_t *table, uint8_t *rom)
+{
+  uint8_t idx = DS18B20_TABLE_INVALID_IDX;
+  uint8_t byte_idx;
+
+  if ((table->count < DS18B20_TABLE_MAX_DEVS) &&
+      (rom[DS18B20_ROM_FAMILY_IDX] == DS18B20_FAMILY_CODE) &&
+      (rom_crc(rom) == rom[DS18B20_ROM_CRC_IDX]))
+  {
+    idx = table->count++;
+
+    //keep serial bytes in the order they are sent on the bus
+    for (byte_idx = 0; byte_idx < DS18B20_SERIAL_LEN_BYTES; byte_idx++)
+    {
+      table->serial[idx][byte_idx] = rom[DS18B20_ROM_FAMILY_IDX - 1 - byte_idx];
+    }
+
+    table->raw[idx] = 0;
+    DS18B20_CLR_FLAG(table->valid, idx);
+    DS18B20_CLR_FLAG(table->error, idx);
+  }
+
+  return idx;
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_discover(ds18b20_table_t *table)
+{
+  bool err = false;
+  uint8_t idx;
+  uint8_t last_deviation = 0;
+  uint8_t search[DS18B20_ROM_LEN_BYTES] = {0};
+  uint8_t rom[DS18B20_ROM_LEN_BYTES];
+
+  //rediscovery replaces previous entries
+  table->count = 0;
+
+  do
+  {
+    //every search pass starts with a reset
+    if (!owi_detect_presence(table->pin))
+    {
+      err = true;
+      break;
+    }
+
+    last_deviation = owi_search_rom(search, last_deviation, table->pin);
+
+    if (last_deviation == OWI_ROM_SEARCH_FAILED)
+    {
+      err = true;
+      break;
+    }
+
+    //search fills the ROM in bus order, the driver expects it reversed
+    for (idx = 0; idx < DS18B20_ROM_LEN_BYTES; idx++)
+    {
+      rom[idx] = search[DS18B20_ROM_LEN_BYTES - 1 - idx];
+    }
+
+    //other device families and corrupted ROMs are skipped
+    if ((rom[DS18B20_ROM_FAMILY_IDX] == DS18B20_FAMILY_CODE) &&
+        (rom_crc(rom) == rom[DS18B20_ROM_CRC_IDX]))
+    {
+      //only a full table aborts the search
+      if (ds18b20_table_add(table, rom) == DS18B20_TABLE_INVALID_IDX)
+      {
+        err = true;
+        break;
+      }
+    }
+  } while (last_deviation != 0);
+
+  if (table->count == 0)
+  {
+    err = true;
+  }
+
+  return err;
+}
+
+//See DS18B20_table.h
+void ds18b20_table_get_rom(ds18b20_table_t *table, uint8_t idx, uint8_t *rom)
+{
+  uint8_t byte_idx;
+
+  rom[DS18B20_ROM_FAMILY_IDX] = DS18B20_FAMILY_CODE;
+
+  for (byte_idx = 0; byte_idx < DS18B20_SERIAL_LEN_BYTES; byte_idx++)
+  {
+    rom[DS18B20_ROM_FAMILY_IDX - 1 - byte_idx] = table->serial[idx][byte_idx];
+  }
+
+  rom[DS18B20_ROM_CRC_IDX] = rom_crc(rom);
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_sweep(ds18b20_table_t *table)
+{
+  bool err = false;
+  uint8_t idx;
+
+  //one broadcast conversion for the whole bus
+  err = ds18b20_convert_all(table->pin);
+
+  if (!err)
+  {
+    err = ds18b20_table_readout(table);
+  }
+
+  else
+  {
+    //no device answered, invalidate every reading
+    for (idx = 0; idx < table->count; idx++)
+    {
+      DS18B20_CLR_FLAG(table->valid, idx);
+      DS18B20_SET_FLAG(table->error, idx);
+    }
+  }
+
+  return err;
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_readout(ds18b20_table_t *table)
+{
+  bool err = false;
+  uint8_t idx;
+  uint8_t rom[DS18B20_ROM_LEN_BYTES];
+
+  for (idx = 0; idx < table->count; idx++)
+  {
+    ds18b20_table_get_rom(table, idx, rom);
+
+    if (ds18b20_read_raw(rom, table->pin, &table->raw[idx]))
+    {
+      DS18B20_CLR_FLAG(table->valid, idx);
+      DS18B20_SET_FLAG(table->error, idx);
+      err = true;
+    }
+
+    else
+    {
+      DS18B20_SET_FLAG(table->valid, idx);
+      DS18B20_CLR_FLAG(table->error, idx);
+    }
+  }
+
+  return err;
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_is_valid(ds18b20_table_t *table, uint8_t idx)
+{
+  return DS18B20_GET_FLAG(table->valid, idx);
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_is_error(ds18b20_table_t *table, uint8_t idx)
+{
+  return DS18B20_GET_FLAG(table->error, idx);
+}
+
+//See DS18B20_table.h
+bool ds18b20_table_provision(ds18b20_table_t *table, ds18b20_config_t *config,
+                             uint8_t *diverged)
+{
+  bool err = false;
+  uint8_t idx;
+  uint8_t rom[DS18B20_ROM_LEN_BYTES];
+  ds18b20_config_t readback;
+
+  //one write and one EEPROM copy for the whole bus
+  err = ds18b20_broadcast_config(table->pin, config);
+
+  if (diverged != NULL)
+  {
+    for (idx = 0; idx < DS18B20_TABLE_FLAG_BYTES; idx++)
+    {
+      diverged[idx] = 0;
+    }
+
+    //verify what landed in EEPROM, not just the scratchpad
+    if (!err)
+    {
+      err = ds18b20_broadcast_recall(table->pin);
+    }
+
+    for (idx = 0; idx < table->count; idx++)
+    {
+      if (!err)
+      {
+        ds18b20_table_get_rom(table, idx, rom);
+
+        if ((ds18b20_read_config(rom, table->pin, &readback) == DS18B20_OK) &&
+            (readback.th == config->th) &&
+            (readback.tl == config->tl) &&
+            (readback.resolution == config->resolution))
+        {
+          continue;
+        }
+      }
+
+      DS18B20_SET_FLAG(diverged, idx);
+    }
+
+    for (idx = 0; idx < DS18B20_TABLE_FLAG_BYTES; idx++)
+    {
+      if (diverged[idx])
+      {
+        err = true;
+      }
+    }
+  }
+
+  return err;
+}
@@ -0,0 +1,171 @@
+/***************************************************************
+ * @file ds18b20_table.h
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Compact structure-of-arrays table of DS18B20 devices
+ * sharing a single OWI bus. The bus pin is stored once per
+ * table and only the 48-bit serial number of each ROM is kept;
+ * the family code is implied and the ROM CRC is recomputed
+ * when the device is addressed. Readings are stored raw in
+ * units of 1/16 degrees Celsius and status flags are packed
+ * into bitsets.
+ *
+ **************************************************************/
+
+#ifndef _DS18B20_TABLE_H
+#define _DS18B20_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************
+                          Includes
+***************************************************************/
+#include "DS18B20.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************
+                           Macros
+***************************************************************/
+//maximum number of devices held by a table
+#ifndef DS18B20_TABLE_MAX_DEVS
+#define DS18B20_TABLE_MAX_DEVS 64
+#endif
+
+//serial number bytes stored per device (family and CRC dropped)
+#define DS18B20_SERIAL_LEN_BYTES 6
+
+//bytes needed to hold one flag bit per device
+#define DS18B20_TABLE_FLAG_BYTES ((DS18B20_TABLE_MAX_DEVS + 7) / 8)
+
+//access to one bit of a per-device flag bitset
+#define DS18B20_FLAG_BYTE(idx) ((idx) >> 3)
+#define DS18B20_FLAG_MASK(idx) (1 << ((idx) & 0x07))
+
+#define DS18B20_SET_FLAG(flags, idx) \
+  ((flags)[DS18B20_FLAG_BYTE(idx)] |= DS18B20_FLAG_MASK(idx))
+#define DS18B20_CLR_FLAG(flags, idx) \
+  ((flags)[DS18B20_FLAG_BYTE(idx)] &= ~DS18B20_FLAG_MASK(idx))
+#define DS18B20_GET_FLAG(flags, idx) \
+  (((flags)[DS18B20_FLAG_BYTE(idx)] & DS18B20_FLAG_MASK(idx)) != 0)
+
+//SRAM footprint of a table, known at compile time
+#define DS18B20_TABLE_SIZE_BYTES (2 + \
+  (DS18B20_TABLE_MAX_DEVS * DS18B20_SERIAL_LEN_BYTES) + \
+  (DS18B20_TABLE_MAX_DEVS * 2) + \
+  (DS18B20_TABLE_FLAG_BYTES * 2))
+
+//returned by ds18b20_table_add() when the table is full
+#define DS18B20_TABLE_INVALID_IDX 0xFF
+
+/**************************************************************
+                          Typedefs
+***************************************************************/
+typedef struct {
+  uint8_t  pin;
+  uint8_t  count;
+  uint8_t  serial[DS18B20_TABLE_MAX_DEVS][DS18B20_SERIAL_LEN_BYTES];
+  int16_t  raw[DS18B20_TABLE_MAX_DEVS];
+  uint8_t  valid[DS18B20_TABLE_FLAG_BYTES];
+  uint8_t  error[DS18B20_TABLE_FLAG_BYTES];
+} ds18b20_table_t;
+
+/**************************************************************
+                       Public Functions
+***************************************************************/
+/*!
+ * @brief Initializes an empty device table and the OWI bus
+ * on the defined pin.
+ * @param[in] table Pointer to device table.
+ * @param[in] pin OWI bus pin where devices are connected.
+ * @return bool
+ */
+bool ds18b20_table_init(ds18b20_table_t *table, uint8_t pin);
+
+/*!
+ * @brief Adds a device to the table. The ROM must carry the
+ * DS18B20 family code and a valid CRC. Returns the index of
+ * the new entry or DS18B20_TABLE_INVALID_IDX on failure.
+ * @param[in] table Pointer to device table.
+ * @param[in] rom Pointer to 8-byte device ROM.
+ * @return uint8_t
+ */
+uint8_t ds18b20_table_add(ds18b20_table_t *table, uint8_t *rom);
+
+/*!
+ * @brief Searches the OWI bus and fills the table with every
+ * DS18B20 device found, replacing any previous entries. ROMs
+ * failing the CRC are skipped. Returns Boolean true if the search
+ * failed, the table filled up or no device was found.
+ * @param[in] table Pointer to device table.
+ * @return bool
+ */
+bool ds18b20_table_discover(ds18b20_table_t *table);
+
+/*!
+ * @brief Rebuilds the full 8-byte ROM of a table entry, ready
+ * to be passed to the OWI driver.
+ * @param[in] table Pointer to device table.
+ * @param[in] idx Table index of device.
+ * @param[out] rom 8-byte buffer to store device ROM.
+ * @return None.
+ */
+void ds18b20_table_get_rom(ds18b20_table_t *table, uint8_t idx, uint8_t *rom);
+
+/*!
+ * @brief Starts a conversion on every device at once and reads
+ * each device back into the table. Per-device valid and error
+ * flags are updated. Returns Boolean true if any device failed.
+ * @param[in] table Pointer to device table.
+ * @return bool
+ */
+bool ds18b20_table_sweep(ds18b20_table_t *table);
+
+/*!
+ * @brief Reads every device back into the table without starting
+ * a conversion. Per-device valid and error flags are updated.
+ * Returns Boolean true if any device failed.
+ * @param[in] table Pointer to device table.
+ * @return bool
+ */
+bool ds18b20_table_readout(ds18b20_table_t *table);
+
+/*!
+ * @brief Provisions every device on the bus with the same alarm
+ * thresholds and resolution using broadcast writes. If diverged
+ * is not NULL, EEPROM is recalled and each device is read back;
+ * the flag of every device whose configuration differs or could
+ * not be read is set. Returns Boolean true if the broadcast
+ * failed or any device diverged.
+ * @param[in] table Pointer to device table.
+ * @param[in] config Pointer to configuration to write.
+ * @param[out] diverged Bitset of DS18B20_TABLE_FLAG_BYTES, or NULL.
+ * @return bool
+ */
+bool ds18b20_table_provision(ds18b20_table_t *table, ds18b20_config_t *config,
+                             uint8_t *diverged);
+
+/*!
+ * @brief Indicates whether the last reading of a device is valid.
+ * @param[in] table Pointer to device table.
+ * @param[in] idx Table index of device.
+ * @return bool
+ */
+bool ds18b20_table_is_valid(ds18b20_table_t *table, uint8_t idx);
+
+/*!
+ * @brief Indicates whether the last readout of a device failed.
+ * @param[in] table Pointer to device table.
+ * @param[in] idx Table index of device.
+ * @return bool
+ */
+bool ds18b20_table_is_error(ds18b20_table_t *table, uint8_t idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DS18B20_TABLE_H */
@@ -4,8 +4,9 @@
  * @par Nicholas Shanahan (2016)
  *
  * @brief Arduino application for DS18B20 temperature sensor.
- * Prints temperature in degrees fahrentheit approximately
- * every two seconds to the Arduino serial console.
+ * Samples the temperature approximately every two seconds and
+ * prints it in degrees fahrentheit to the Arduino serial console
+ * whenever the filtered reading changes.
  *
  **************************************************************/
  
@@ -13,6 +14,7 @@
         Includes
 ***************************************************************/
 #include "DS18B20.h"
+#include "DS18B20_filter.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -25,6 +27,7 @@
          Variables
 ***************************************************************/
 ds18b20_dev_t dev;
+ds18b20_filter_t filter;
 bool err = false;
 
 /**************************************************************
@@ -35,6 +38,7 @@ void setup()
   uint8_t idx;
   
   Serial.begin(9600);
+  ds18b20_filter_init(&filter);
   //setup DS18B20
   err = ds18b20_init(&dev, DS18B20_PIN);
   
@@ -70,9 +74,13 @@ void loop()
   
   if(!err)
   {
-    fahrenheit_temp = (dev.temp*9)/5 + 32;
-    Serial.print("Temperature(°F): ");
-    Serial.println(fahrenheit_temp, 4);
+    //only report readings that moved outside the deadband
+    if (ds18b20_filter_update(&filter, dev.raw))
+    {
+      fahrenheit_temp = (ds18b20_filter_value(&filter)*DS18B20_PRECISION*9)/5 + 32;
+      Serial.print("Temperature(°F): ");
+      Serial.println(fahrenheit_temp, 4);
+    }
   }
   
   else
@@ -81,4 +89,4 @@ void loop()
   }
   
   delay(2000);
-}
+}
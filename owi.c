@@ -36,7 +36,6 @@
 
 #define BYTE_TO_BITS 8
 #define ROM_LEN_BYTES 8
-#define ROM_SEARCH_FAILED 0xFF
 
 //ROM Commands
 #define SKIP_ROM_CMD   0xCC
@@ -267,7 +266,7 @@ uint8_t owi_search_rom(uint8_t *rom, uint8_t last_deviation, uint8_t pin)
             if (bit1 && bit2)
             {
                 err = true;
-                new_deviation = ROM_SEARCH_FAILED;
+                new_deviation = OWI_ROM_SEARCH_FAILED;
                 break;
             }
                      
@@ -323,4 +322,4 @@ uint8_t owi_search_rom(uint8_t *rom, uint8_t last_deviation, uint8_t pin)
     }
 
     return new_deviation;
-}
+}
@@ -35,6 +35,9 @@ extern "C" {
  */
 #define OWI_PORT D
 
+//returned by owi_search_rom() when no device answered the search
+#define OWI_ROM_SEARCH_FAILED 0xFF
+
 /**************************************************************
                       Pulbic Functions
 ***************************************************************/
@@ -130,4 +133,4 @@ uint8_t owi_search_rom(uint8_t *rom, uint8_t last_deviation, uint8_t pin);
 }
 #endif
 
-#endif /* _OWI_H */
+#endif /* _OWI_H */
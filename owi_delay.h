@@ -28,4 +28,8 @@
 #define OWI_DELAY_US_I  70
 #define OWI_DELAY_US_J  410
 
-#endif /* _OWI_DELAY_H */
+//duration of one bit slot and of a reset with presence detect
+#define OWI_SLOT_US  (OWI_DELAY_US_A + OWI_DELAY_US_E + OWI_DELAY_US_F)
+#define OWI_RESET_US (OWI_DELAY_US_H + OWI_DELAY_US_I + OWI_DELAY_US_J)
+
+#endif /* _OWI_DELAY_H */
@@ -0,0 +1,1181 @@
+/***************************************************************
+ * @file owi_decode.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Host tool that decodes logic analyzer captures of an OWI
+ * bus into resets, bit slots, bytes, ROM commands and DS18B20
+ * function commands, and reports per-slot timing margins and
+ * bus throughput. The protocol state tells read slots from write
+ * slots, and the two are reported separately since the slave
+ * samples them at different points. Pulses are classified with the timing model
+ * of owi_delay.h.
+ *
+ * Accepted inputs are sigrok CSV exports (one column per channel,
+ * ';' comment lines and a channel name header are skipped) and
+ * sigrok binary exports (one byte per sample). Edge detection
+ * packs 64 samples into a level word at a time, using SSE2 when
+ * available, and only visits the samples where the level changes.
+ *
+ * The tool can also synthesize a binary capture of DS18B20
+ * conversions and readouts following owi_delay.h, which is useful
+ * to check the decoder without hardware.
+ *
+ * Build:  cc -O2 -o owi_decode tools/owi_decode.c
+ * Usage:  owi_decode -r <rate_hz> [-c channel] [-b] [-q] <capture>
+ *         owi_decode -r <rate_hz> -s <count> <output.bin>
+ *
+ **************************************************************/
+
+/**************************************************************
+                            Includes
+***************************************************************/
+#include "../owi_delay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**************************************************************
+                            Macros
+***************************************************************/
+#define CHUNK_BYTES (1 << 20)
+#define MAX_DATA_BYTES 16
+#define ROM_LEN_BYTES 8
+#define SEARCH_BITS (ROM_LEN_BYTES * 8 * 3)
+
+//gap between pulses above which slots are not treated as consecutive
+#define IDLE_GAP_US 1000.0
+
+//low pulses at least this long are resets
+#define RESET_MIN_US (OWI_DELAY_US_H / 2)
+//master samples presence this long after releasing the bus
+#define PRESENCE_SAMPLE_US OWI_DELAY_US_I
+//window after a reset in which a low pulse is a presence pulse
+#define PRESENCE_WINDOW_US (OWI_DELAY_US_I + OWI_DELAY_US_J)
+//master samples a read slot this long after driving the bus low
+#define SLOT_SAMPLE_US (OWI_DELAY_US_A + OWI_DELAY_US_E)
+//slave samples a write slot within this window after it starts
+#define WRITE_SAMPLE_MIN_US 15
+#define WRITE_SAMPLE_MAX_US 60
+
+//ROM Commands
+#define READ_ROM_CMD     0x33
+#define MATCH_ROM_CMD    0x55
+#define SKIP_ROM_CMD     0xCC
+#define SEARCH_ROM_CMD   0xF0
+#define ALARM_SEARCH_CMD 0xEC
+
+//DS18B20 function commands
+#define CONVERT_TEMP_CMD     0x44
+#define WRITE_SCRATCHPAD_CMD 0x4E
+#define READ_SCRATCHPAD_CMD  0xBE
+#define COPY_SCRATCHPAD_CMD  0x48
+#define RECALL_E2_CMD        0xB8
+#define READ_POWER_CMD       0xB4
+
+#define SCRATCHPAD_LEN_BYTES 9
+
+/**************************************************************
+                            Typedefs
+***************************************************************/
+typedef enum {
+    STATE_IDLE,
+    STATE_ROM_CMD,
+    STATE_ROM_BYTES,
+    STATE_SEARCH,
+    STATE_FUNC_CMD,
+    STATE_POLL,
+    STATE_DATA
+} proto_state_t;
+
+typedef enum {
+    SLOT_NONE,
+    SLOT_READ,
+    SLOT_WRITE
+} slot_dir_t;
+
+typedef struct {
+    uint64_t count;
+    double   low_min;
+    double   low_max;
+    double   low_sum;
+    double   margin_min;
+} slot_stats_t;
+
+typedef struct {
+    //sample clock
+    double   us_per_sample;
+    uint64_t sample_base;
+    bool     started;
+    uint8_t  prev_level;
+
+    //pulse tracking
+    uint64_t last_fall;
+    uint64_t last_rise;
+    bool     have_rise;
+    bool     prev_was_slot;
+    bool     awaiting_presence;
+
+    //transaction being decoded
+    proto_state_t state;
+    uint64_t txn_start;
+    bool     presence;
+    int      rom_cmd;
+    int      func_cmd;
+    uint8_t  rom[ROM_LEN_BYTES];
+    uint8_t  rom_len;
+    uint16_t search_bits;
+    uint8_t  data[MAX_DATA_BYTES];
+    uint8_t  data_len;
+    uint8_t  bit_acc;
+    uint8_t  bit_count;
+    uint32_t polls;
+    uint32_t poll_ones;
+    bool     quiet;
+
+    //totals
+    uint64_t edges;
+    uint64_t resets;
+    uint64_t presences;
+    uint64_t bits;
+    uint64_t bytes;
+    uint64_t transactions;
+    uint64_t crc_errors;
+    uint64_t first_activity;
+    uint64_t last_activity;
+    bool     have_activity;
+
+    //timing margins
+    slot_stats_t read1;
+    slot_stats_t read0;
+    slot_stats_t write1;
+    slot_stats_t write0;
+    uint64_t stray_slots;
+    double   reset_low_min;
+    double   presence_margin_min;
+    double   recovery_min;
+    double   slot_period_min;
+} decoder_t;
+
+/**************************************************************
+                     Private Functions
+***************************************************************/
+/*!
+ * @brief Computes the CRC8 of a byte of data. Same algorithm
+ * as crc8() in owi_crc.c.
+ * @param[in] data Data byte to perform CRC on.
+ * @param[in] seed CRC seed value.
+ * @return uint8_t
+ */
+static uint8_t crc8(uint8_t data, uint8_t seed)
+{
+    int idx;
+
+    for (idx = 0; idx < 8; idx++)
+    {
+        seed = ((data ^ seed) & 0x01) ? ((seed >> 1) ^ 0x8C) : (seed >> 1);
+        data >>= 1;
+    }
+
+    return seed;
+}
+
+static void stats_init(slot_stats_t *stats)
+{
+    stats->count = 0;
+    stats->low_min = 1e30;
+    stats->low_max = 0;
+    stats->low_sum = 0;
+    stats->margin_min = 1e30;
+}
+
+static void stats_add(slot_stats_t *stats, double low_us, double margin_us)
+{
+    stats->count++;
+    stats->low_sum += low_us;
+
+    if (low_us < stats->low_min) stats->low_min = low_us;
+    if (low_us > stats->low_max) stats->low_max = low_us;
+    if (margin_us < stats->margin_min) stats->margin_min = margin_us;
+}
+
+static const char *rom_cmd_name(int cmd)
+{
+    switch (cmd)
+    {
+        case READ_ROM_CMD:     return "READ_ROM";
+        case MATCH_ROM_CMD:    return "MATCH_ROM";
+        case SKIP_ROM_CMD:     return "SKIP_ROM";
+        case SEARCH_ROM_CMD:   return "SEARCH_ROM";
+        case ALARM_SEARCH_CMD: return "ALARM_SEARCH";
+        default:               return "ROM?";
+    }
+}
+
+static const char *func_cmd_name(int cmd)
+{
+    switch (cmd)
+    {
+        case CONVERT_TEMP_CMD:     return "CONVERT_T";
+        case WRITE_SCRATCHPAD_CMD: return "WRITE_SCRATCHPAD";
+        case READ_SCRATCHPAD_CMD:  return "READ_SCRATCHPAD";
+        case COPY_SCRATCHPAD_CMD:  return "COPY_SCRATCHPAD";
+        case RECALL_E2_CMD:        return "RECALL_E2";
+        case READ_POWER_CMD:       return "READ_POWER_SUPPLY";
+        default:                   return "FUNC?";
+    }
+}
+
+/*!
+ * @brief Prints the transaction decoded since the last reset.
+ */
+static void flush_transaction(decoder_t *dec)
+{
+    int idx;
+    uint8_t crc = 0;
+
+    if (dec->state == STATE_IDLE)
+    {
+        return;
+    }
+
+    dec->transactions++;
+
+    if ((dec->func_cmd == READ_SCRATCHPAD_CMD) &&
+        (dec->data_len >= SCRATCHPAD_LEN_BYTES))
+    {
+        for (idx = 0; idx < SCRATCHPAD_LEN_BYTES - 1; idx++)
+        {
+            crc = crc8(dec->data[idx], crc);
+        }
+
+        if (crc != dec->data[SCRATCHPAD_LEN_BYTES - 1])
+        {
+            dec->crc_errors++;
+        }
+    }
+
+    if (dec->quiet)
+    {
+        return;
+    }
+
+    printf("%12.3f ms  %s", dec->txn_start * dec->us_per_sample / 1000.0,
+           dec->presence ? "presence" : "NO-PRESENCE");
+
+    if (dec->rom_cmd >= 0)
+    {
+        printf("  %s", rom_cmd_name(dec->rom_cmd));
+    }
+
+    if (dec->rom_len == ROM_LEN_BYTES)
+    {
+        printf(" ");
+        for (idx = 0; idx < ROM_LEN_BYTES; idx++)
+        {
+            printf("%02X", dec->rom[idx]);
+        }
+    }
+
+    if (dec->func_cmd >= 0)
+    {
+        printf("  %s", func_cmd_name(dec->func_cmd));
+    }
+
+    if (dec->data_len > 0)
+    {
+        printf(" [");
+        for (idx = 0; idx < dec->data_len; idx++)
+        {
+            printf("%s%02X", idx ? " " : "", dec->data[idx]);
+        }
+        printf("]");
+    }
+
+    if ((dec->func_cmd == READ_SCRATCHPAD_CMD) &&
+        (dec->data_len >= SCRATCHPAD_LEN_BYTES))
+    {
+        if (crc == dec->data[SCRATCHPAD_LEN_BYTES - 1])
+        {
+            printf(" %.4f C", (int16_t)((dec->data[1] << 8) | dec->data[0]) * 0.0625);
+        }
+
+        else
+        {
+            printf(" CRC-ERROR");
+        }
+    }
+
+    if (dec->polls > 0)
+    {
+        printf("  polls=%u (%u ready)", dec->polls, dec->poll_ones);
+    }
+
+    if (dec->bit_count > 0)
+    {
+        printf("  +%u stray bits", dec->bit_count);
+    }
+
+    printf("\n");
+}
+
+/*!
+ * @brief Feeds one decoded byte to the protocol state machine.
+ */
+static void push_byte(decoder_t *dec, uint8_t byte)
+{
+    dec->bytes++;
+
+    switch (dec->state)
+    {
+        case STATE_ROM_CMD:
+            dec->rom_cmd = byte;
+
+            if ((byte == READ_ROM_CMD) || (byte == MATCH_ROM_CMD))
+            {
+                dec->state = STATE_ROM_BYTES;
+            }
+
+            else if ((byte == SEARCH_ROM_CMD) || (byte == ALARM_SEARCH_CMD))
+            {
+                memset(dec->rom, 0, sizeof(dec->rom));
+                dec->state = STATE_SEARCH;
+            }
+
+            else if (byte == SKIP_ROM_CMD)
+            {
+                dec->state = STATE_FUNC_CMD;
+            }
+
+            else
+            {
+                dec->state = STATE_DATA;
+            }
+            break;
+
+        case STATE_ROM_BYTES:
+            dec->rom[dec->rom_len++] = byte;
+
+            if (dec->rom_len == ROM_LEN_BYTES)
+            {
+                dec->state = STATE_FUNC_CMD;
+            }
+            break;
+
+        case STATE_FUNC_CMD:
+            dec->func_cmd = byte;
+
+            switch (byte)
+            {
+                case CONVERT_TEMP_CMD:
+                case COPY_SCRATCHPAD_CMD:
+                case RECALL_E2_CMD:
+                case READ_POWER_CMD:
+                    dec->state = STATE_POLL;
+                    break;
+
+                default:
+                    dec->state = STATE_DATA;
+                    break;
+            }
+            break;
+
+        case STATE_DATA:
+            if (dec->data_len < MAX_DATA_BYTES)
+            {
+                dec->data[dec->data_len++] = byte;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*!
+ * @brief Returns whether the next slot is driven by the master
+ * (write) or sampled by it (read), from the protocol state.
+ */
+static slot_dir_t slot_dir(decoder_t *dec)
+{
+    switch (dec->state)
+    {
+        case STATE_ROM_CMD:
+        case STATE_FUNC_CMD:
+            return SLOT_WRITE;
+
+        case STATE_ROM_BYTES:
+            //MATCH_ROM sends the ROM, READ_ROM receives it
+            return (dec->rom_cmd == MATCH_ROM_CMD) ? SLOT_WRITE : SLOT_READ;
+
+        case STATE_SEARCH:
+            //id and complement are read, the direction is written
+            return ((dec->search_bits % 3) == 2) ? SLOT_WRITE : SLOT_READ;
+
+        case STATE_POLL:
+            return SLOT_READ;
+
+        case STATE_DATA:
+            return (dec->func_cmd == WRITE_SCRATCHPAD_CMD) ? SLOT_WRITE : SLOT_READ;
+
+        default:
+            //slots without a preceding reset
+            return SLOT_NONE;
+    }
+}
+
+/*!
+ * @brief Feeds one decoded bit to the protocol state machine.
+ */
+static void push_bit(decoder_t *dec, bool bit)
+{
+    uint16_t rom_bit;
+
+    dec->bits++;
+
+    if (dec->state == STATE_IDLE)
+    {
+        //slots without a preceding reset
+        return;
+    }
+
+    if (dec->state == STATE_POLL)
+    {
+        dec->polls++;
+        dec->poll_ones += bit;
+        return;
+    }
+
+    if (dec->state == STATE_SEARCH)
+    {
+        //every third bit of a triplet is the direction taken
+        if ((dec->search_bits % 3) == 2)
+        {
+            rom_bit = dec->search_bits / 3;
+
+            if (bit)
+            {
+                dec->rom[rom_bit >> 3] |= (1 << (rom_bit & 0x07));
+            }
+        }
+
+        if (++dec->search_bits == SEARCH_BITS)
+        {
+            dec->rom_len = ROM_LEN_BYTES;
+            dec->state = STATE_FUNC_CMD;
+        }
+        return;
+    }
+
+    //bytes are sent LSB first
+    dec->bit_acc |= (bit << dec->bit_count);
+
+    if (++dec->bit_count == 8)
+    {
+        push_byte(dec, dec->bit_acc);
+        dec->bit_acc = 0;
+        dec->bit_count = 0;
+    }
+}
+
+/*!
+ * @brief Classifies a low pulse as reset, presence or bit slot.
+ * @param[in] start Sample index of the falling edge.
+ * @param[in] end Sample index of the rising edge.
+ */
+static void handle_pulse(decoder_t *dec, uint64_t start, uint64_t end)
+{
+    double low_us = (end - start) * dec->us_per_sample;
+    double wait_us;
+    double margin;
+    bool bit;
+    slot_dir_t dir;
+
+    if (!dec->have_activity)
+    {
+        dec->first_activity = start;
+        dec->have_activity = true;
+    }
+    dec->last_activity = end;
+
+    if (low_us >= RESET_MIN_US)
+    {
+        flush_transaction(dec);
+
+        dec->resets++;
+        if (low_us < dec->reset_low_min) dec->reset_low_min = low_us;
+
+        dec->state = STATE_ROM_CMD;
+        dec->txn_start = start;
+        dec->presence = false;
+        dec->rom_cmd = -1;
+        dec->func_cmd = -1;
+        dec->rom_len = 0;
+        dec->search_bits = 0;
+        dec->data_len = 0;
+        dec->bit_acc = 0;
+        dec->bit_count = 0;
+        dec->polls = 0;
+        dec->poll_ones = 0;
+        dec->awaiting_presence = true;
+        dec->prev_was_slot = false;
+        return;
+    }
+
+    if (dec->awaiting_presence)
+    {
+        dec->awaiting_presence = false;
+        wait_us = (start - dec->last_rise) * dec->us_per_sample;
+
+        if (wait_us < PRESENCE_WINDOW_US)
+        {
+            //line must be low when the master samples it
+            margin = PRESENCE_SAMPLE_US - wait_us;
+            if ((wait_us + low_us - PRESENCE_SAMPLE_US) < margin)
+            {
+                margin = wait_us + low_us - PRESENCE_SAMPLE_US;
+            }
+            if (margin < dec->presence_margin_min) dec->presence_margin_min = margin;
+
+            dec->presences++;
+            dec->presence = true;
+            return;
+        }
+    }
+
+    dir = slot_dir(dec);
+
+    if (dir == SLOT_WRITE)
+    {
+        //a 1 is released before the window, a 0 held low through it
+        bit = (low_us < WRITE_SAMPLE_MIN_US);
+
+        if (bit)
+        {
+            stats_add(&dec->write1, low_us, WRITE_SAMPLE_MIN_US - low_us);
+        }
+
+        else
+        {
+            stats_add(&dec->write0, low_us, low_us - WRITE_SAMPLE_MAX_US);
+        }
+    }
+
+    else
+    {
+        //the line is high at the master's sample point for a 1
+        bit = (low_us < SLOT_SAMPLE_US);
+
+        if (dir == SLOT_NONE)
+        {
+            dec->stray_slots++;
+        }
+
+        else if (bit)
+        {
+            stats_add(&dec->read1, low_us, SLOT_SAMPLE_US - low_us);
+        }
+
+        else
+        {
+            stats_add(&dec->read0, low_us, low_us - SLOT_SAMPLE_US);
+        }
+    }
+
+    push_bit(dec, bit);
+    dec->prev_was_slot = true;
+}
+
+/*!
+ * @brief Handles one level change of the bus.
+ * @param[in] sample Sample index of the edge.
+ * @param[in] level Bus level after the edge.
+ */
+static void handle_edge(decoder_t *dec, uint64_t sample, uint8_t level)
+{
+    double high_us;
+    double period_us;
+
+    dec->edges++;
+
+    if (level == 0)
+    {
+        if (dec->have_rise && dec->prev_was_slot)
+        {
+            high_us = (sample - dec->last_rise) * dec->us_per_sample;
+            period_us = (sample - dec->last_fall) * dec->us_per_sample;
+
+            //only consecutive slots count towards recovery and period
+            if (high_us < IDLE_GAP_US)
+            {
+                if (high_us < dec->recovery_min) dec->recovery_min = high_us;
+                if (period_us < dec->slot_period_min) dec->slot_period_min = period_us;
+            }
+        }
+
+        dec->last_fall = sample;
+    }
+
+    else if (dec->started)
+    {
+        handle_pulse(dec, dec->last_fall, sample);
+        dec->last_rise = sample;
+        dec->have_rise = true;
+    }
+}
+
+/*!
+ * @brief Scans a word of up to 64 bus levels for edges.
+ * @param[in] levels Bus level of each sample, first sample in bit 0.
+ * @param[in] count Number of valid samples in the word.
+ */
+static void feed_levels(decoder_t *dec, uint64_t levels, unsigned count)
+{
+    uint64_t edges;
+    unsigned bit;
+
+    if (!dec->started)
+    {
+        dec->prev_level = levels & 0x01;
+    }
+
+    edges = levels ^ ((levels << 1) | dec->prev_level);
+
+    if (count < 64)
+    {
+        edges &= (((uint64_t)1) << count) - 1;
+    }
+
+    //a low level at capture start has no falling edge to pair with
+    if (!dec->started)
+    {
+        dec->started = (dec->prev_level != 0);
+        dec->last_fall = dec->sample_base;
+    }
+
+    while (edges)
+    {
+        bit = __builtin_ctzll(edges);
+        edges &= edges - 1;
+
+        if (!dec->started)
+        {
+            //first rising edge after a low start
+            dec->started = true;
+            continue;
+        }
+
+        handle_edge(dec, dec->sample_base + bit, (levels >> bit) & 0x01);
+    }
+
+    dec->prev_level = (levels >> (count - 1)) & 0x01;
+    dec->sample_base += count;
+}
+
+/*!
+ * @brief Packs the channel bit of 64 one-byte samples into a
+ * level word.
+ */
+static uint64_t gather_levels(const uint8_t *samples, unsigned channel)
+{
+    uint64_t levels = 0;
+    unsigned idx;
+
+#ifdef __SSE2__
+    __m128i shift = _mm_cvtsi32_si128(7 - channel);
+
+    //move the channel bit to the top of each byte, collect with movemask
+    for (idx = 0; idx < 64; idx += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(samples + idx));
+        v = _mm_sll_epi16(v, shift);
+        levels |= ((uint64_t)(uint16_t)_mm_movemask_epi8(v)) << idx;
+    }
+#else
+    uint64_t word;
+
+    //isolate the channel bit in each byte, gather with a multiply
+    for (idx = 0; idx < 64; idx += 8)
+    {
+        memcpy(&word, samples + idx, sizeof(word));
+        word = (word >> channel) & 0x0101010101010101ULL;
+        levels |= ((word * 0x0102040810204080ULL) >> 56) << idx;
+    }
+#endif
+
+    return levels;
+}
+
+static void decode_binary(decoder_t *dec, FILE *fp, unsigned channel)
+{
+    static uint8_t buf[CHUNK_BYTES];
+    size_t len;
+    size_t idx;
+    uint64_t levels;
+    unsigned count;
+
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        for (idx = 0; idx + 64 <= len; idx += 64)
+        {
+            levels = gather_levels(buf + idx, channel);
+
+            //skip samples without a level change in one step
+            if (dec->started &&
+                (levels == (dec->prev_level ? ~(uint64_t)0 : 0)))
+            {
+                dec->sample_base += 64;
+                continue;
+            }
+
+            feed_levels(dec, levels, 64);
+        }
+
+        //tail of the final chunk
+        if (idx < len)
+        {
+            levels = 0;
+            for (count = 0; idx < len; idx++, count++)
+            {
+                levels |= ((uint64_t)((buf[idx] >> channel) & 0x01)) << count;
+            }
+            feed_levels(dec, levels, count);
+        }
+    }
+}
+
+static void decode_csv(decoder_t *dec, FILE *fp, unsigned channel)
+{
+    static char buf[CHUNK_BYTES + 1];
+    size_t keep = 0;
+    size_t len;
+    char *line;
+    char *end;
+    char *p;
+    unsigned col;
+    uint64_t levels = 0;
+    unsigned count = 0;
+
+    while ((len = fread(buf + keep, 1, CHUNK_BYTES - keep, fp)) > 0 || keep > 0)
+    {
+        len += keep;
+        buf[len] = '\0';
+        line = buf;
+
+        while ((end = memchr(line, '\n', len - (line - buf))) != NULL ||
+               (feof(fp) && (line < buf + len)))
+        {
+            if (end == NULL)
+            {
+                end = buf + len;
+            }
+
+            //skip comments and the channel name header
+            if ((*line != ';') && (*line >= '0') && (*line <= '9'))
+            {
+                p = line;
+                for (col = 0; (col < channel) && (p < end); p++)
+                {
+                    if (*p == ',')
+                    {
+                        col++;
+                    }
+                }
+
+                levels |= ((uint64_t)(*p == '1')) << count;
+
+                if (++count == 64)
+                {
+                    feed_levels(dec, levels, count);
+                    levels = 0;
+                    count = 0;
+                }
+            }
+
+            line = end + 1;
+            if (line > buf + len)
+            {
+                break;
+            }
+        }
+
+        //carry a partial line over to the next chunk
+        keep = (line < buf + len) ? (size_t)(buf + len - line) : 0;
+        if (keep == CHUNK_BYTES)
+        {
+            fprintf(stderr, "CSV line too long\n");
+            exit(EXIT_FAILURE);
+        }
+        memmove(buf, line, keep);
+
+        if (feof(fp) && keep == 0)
+        {
+            break;
+        }
+    }
+
+    if (count > 0)
+    {
+        feed_levels(dec, levels, count);
+    }
+}
+
+static void print_stats(const char *name, slot_stats_t *stats)
+{
+    if (stats->count == 0)
+    {
+        printf("  %-8s none\n", name);
+        return;
+    }
+
+    printf("  %-8s %10llu slots  low %6.2f / %6.2f / %6.2f us (min/mean/max)"
+           "  margin %6.2f us\n",
+           name, (unsigned long long)stats->count, stats->low_min,
+           stats->low_sum / stats->count, stats->low_max, stats->margin_min);
+}
+
+static void print_report(decoder_t *dec, double wall_s)
+{
+    double duration_s = dec->sample_base * dec->us_per_sample / 1e6;
+    double active_s = 0;
+
+    if (dec->have_activity)
+    {
+        active_s = (dec->last_activity - dec->first_activity) *
+                   dec->us_per_sample / 1e6;
+    }
+
+    printf("\nsamples        %llu (%.3f s)\n",
+           (unsigned long long)dec->sample_base, duration_s);
+    printf("edges          %llu\n", (unsigned long long)dec->edges);
+    printf("resets         %llu (%llu with presence)\n",
+           (unsigned long long)dec->resets, (unsigned long long)dec->presences);
+    printf("transactions   %llu (%llu scratchpad CRC errors)\n",
+           (unsigned long long)dec->transactions,
+           (unsigned long long)dec->crc_errors);
+    printf("bits / bytes   %llu / %llu\n",
+           (unsigned long long)dec->bits, (unsigned long long)dec->bytes);
+
+    printf("\ntiming margins (read sampled at %d us, write window %d-%d us)\n",
+           SLOT_SAMPLE_US, WRITE_SAMPLE_MIN_US, WRITE_SAMPLE_MAX_US);
+    print_stats("read 1", &dec->read1);
+    print_stats("read 0", &dec->read0);
+    print_stats("write 1", &dec->write1);
+    print_stats("write 0", &dec->write0);
+
+    if (dec->stray_slots > 0)
+    {
+        printf("  %llu slots outside a transaction\n",
+               (unsigned long long)dec->stray_slots);
+    }
+
+    if (dec->resets > 0)
+    {
+        printf("  reset    low min %.2f us (margin %.2f us to %d us)\n",
+               dec->reset_low_min, dec->reset_low_min - OWI_DELAY_US_H,
+               OWI_DELAY_US_H);
+    }
+
+    if (dec->presences > 0)
+    {
+        printf("  presence margin %.2f us around %d us sample point\n",
+               dec->presence_margin_min, PRESENCE_SAMPLE_US);
+    }
+
+    if (dec->slot_period_min < 1e29)
+    {
+        printf("  slots    period min %.2f us, recovery min %.2f us\n",
+               dec->slot_period_min, dec->recovery_min);
+    }
+
+    if (active_s > 0)
+    {
+        printf("\nthroughput     %.0f bit/s, %.0f byte/s, %.1f transactions/s "
+               "over %.3f s of activity\n",
+               dec->bits / active_s, dec->bytes / active_s,
+               dec->transactions / active_s, active_s);
+    }
+
+    fprintf(stderr, "decoded %llu samples in %.3f s (%.1f Msamples/s)\n",
+            (unsigned long long)dec->sample_base, wall_s,
+            (wall_s > 0) ? (dec->sample_base / wall_s / 1e6) : 0.0);
+}
+
+/**************************************************************
+                        Synthesizer
+***************************************************************/
+typedef struct {
+    FILE   *fp;
+    double  samples_per_us;
+    double  time_us;
+    uint64_t written;
+} synth_t;
+
+static void emit(synth_t *syn, uint8_t level, double us)
+{
+    static uint8_t buf[CHUNK_BYTES];
+    uint64_t target;
+    uint64_t count;
+    size_t n;
+
+    syn->time_us += us;
+    target = (uint64_t)(syn->time_us * syn->samples_per_us + 0.5);
+    count = target - syn->written;
+    memset(buf, level, (count < sizeof(buf)) ? count : sizeof(buf));
+
+    while (count > 0)
+    {
+        n = (count < sizeof(buf)) ? count : sizeof(buf);
+        fwrite(buf, 1, n, syn->fp);
+        count -= n;
+    }
+
+    syn->written = target;
+}
+
+static void synth_reset(synth_t *syn)
+{
+    emit(syn, 0, OWI_DELAY_US_H);
+    //slave answers 30 us after release with a 120 us presence pulse
+    emit(syn, 1, 30);
+    emit(syn, 0, 120);
+    emit(syn, 1, OWI_DELAY_US_I + OWI_DELAY_US_J - 150);
+}
+
+static void synth_write(synth_t *syn, uint8_t byte)
+{
+    int idx;
+
+    for (idx = 0; idx < 8; idx++, byte >>= 1)
+    {
+        if (byte & 0x01)
+        {
+            emit(syn, 0, OWI_DELAY_US_A);
+            emit(syn, 1, OWI_DELAY_US_B);
+        }
+
+        else
+        {
+            emit(syn, 0, OWI_DELAY_US_C);
+            emit(syn, 1, OWI_DELAY_US_D);
+        }
+    }
+}
+
+static void synth_read_bit(synth_t *syn, bool bit)
+{
+    double slot = OWI_DELAY_US_A + OWI_DELAY_US_E + OWI_DELAY_US_F;
+    //slave holds the line low for 30 us to send a 0
+    double low = bit ? OWI_DELAY_US_A : 30;
+
+    emit(syn, 0, low);
+    emit(syn, 1, slot - low);
+}
+
+static void synth_read(synth_t *syn, uint8_t byte)
+{
+    int idx;
+
+    for (idx = 0; idx < 8; idx++, byte >>= 1)
+    {
+        synth_read_bit(syn, byte & 0x01);
+    }
+}
+
+static void synthesize(FILE *fp, double rate, unsigned count)
+{
+    //ROM in bus order, family code first
+    static const uint8_t rom[ROM_LEN_BYTES] = {
+        0x28, 0xFF, 0x4C, 0x60, 0x91, 0x16, 0x04, 0xB4
+    };
+    uint8_t scratchpad[SCRATCHPAD_LEN_BYTES] = {
+        0x00, 0x00, 0x4B, 0x46, 0x7F, 0xFF, 0x0F, 0x10, 0x00
+    };
+    synth_t syn = {fp, rate / 1e6, 0, 0};
+    unsigned iter;
+    int idx;
+    int16_t raw;
+
+    emit(&syn, 1, 100);
+
+    for (iter = 0; iter < count; iter++)
+    {
+        //temperature ramps so every readout differs
+        raw = (int16_t)(0x0190 + (iter % 64));
+        scratchpad[0] = raw & 0xFF;
+        scratchpad[1] = (raw >> 8) & 0xFF;
+        scratchpad[8] = 0;
+        for (idx = 0; idx < SCRATCHPAD_LEN_BYTES - 1; idx++)
+        {
+            scratchpad[8] = crc8(scratchpad[idx], scratchpad[8]);
+        }
+
+        synth_reset(&syn);
+        synth_write(&syn, SKIP_ROM_CMD);
+        synth_write(&syn, CONVERT_TEMP_CMD);
+        for (idx = 0; idx < 20; idx++)
+        {
+            synth_read_bit(&syn, false);
+        }
+        synth_read_bit(&syn, true);
+
+        synth_reset(&syn);
+        synth_write(&syn, MATCH_ROM_CMD);
+        for (idx = 0; idx < ROM_LEN_BYTES; idx++)
+        {
+            synth_write(&syn, rom[idx]);
+        }
+        synth_write(&syn, READ_SCRATCHPAD_CMD);
+        for (idx = 0; idx < SCRATCHPAD_LEN_BYTES; idx++)
+        {
+            synth_read(&syn, scratchpad[idx]);
+        }
+
+        emit(&syn, 1, IDLE_GAP_US);
+    }
+
+    //final reset closes the last transaction
+    synth_reset(&syn);
+    emit(&syn, 1, 100);
+}
+
+/**************************************************************
+                            Main
+***************************************************************/
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s -r <rate_hz> [-c channel] [-b] [-q] <capture>\n"
+            "       %s -r <rate_hz> -s <count> <output.bin>\n"
+            "  -r  sample rate of the capture in Hz\n"
+            "  -c  channel (CSV column or bit of binary sample), default 0\n"
+            "  -b  capture is sigrok binary output, one byte per sample\n"
+            "  -q  only print the summary report\n"
+            "  -s  synthesize <count> convert/readout cycles instead\n",
+            prog, prog);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    decoder_t dec;
+    double rate = 0;
+    unsigned channel = 0;
+    unsigned synth_count = 0;
+    bool binary = false;
+    bool synth = false;
+    const char *path = NULL;
+    FILE *fp;
+    clock_t begin;
+    int idx;
+
+    memset(&dec, 0, sizeof(dec));
+
+    for (idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "-r") && (idx + 1 < argc))
+        {
+            rate = atof(argv[++idx]);
+        }
+
+        else if (!strcmp(argv[idx], "-c") && (idx + 1 < argc))
+        {
+            channel = (unsigned)atoi(argv[++idx]);
+        }
+
+        else if (!strcmp(argv[idx], "-s") && (idx + 1 < argc))
+        {
+            synth = true;
+            synth_count = (unsigned)atoi(argv[++idx]);
+        }
+
+        else if (!strcmp(argv[idx], "-b"))
+        {
+            binary = true;
+        }
+
+        else if (!strcmp(argv[idx], "-q"))
+        {
+            dec.quiet = true;
+        }
+
+        else if (argv[idx][0] != '-')
+        {
+            path = argv[idx];
+        }
+
+        else
+        {
+            usage(argv[0]);
+        }
+    }
+
+    if ((rate <= 0) || (path == NULL) || (binary && (channel > 7)))
+    {
+        usage(argv[0]);
+    }
+
+    //slots must span a few samples to be measured at all
+    if (rate < 1e6)
+    {
+        fprintf(stderr, "sample rate below 1 MHz cannot resolve bit slots\n");
+        return EXIT_FAILURE;
+    }
+
+    if (synth)
+    {
+        fp = fopen(path, "wb");
+        if (fp == NULL)
+        {
+            perror(path);
+            return EXIT_FAILURE;
+        }
+        synthesize(fp, rate, synth_count);
+        fclose(fp);
+        return EXIT_SUCCESS;
+    }
+
+    fp = fopen(path, binary ? "rb" : "r");
+    if (fp == NULL)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    dec.us_per_sample = 1e6 / rate;
+    dec.state = STATE_IDLE;
+    dec.rom_cmd = -1;
+    dec.func_cmd = -1;
+    stats_init(&dec.read1);
+    stats_init(&dec.read0);
+    stats_init(&dec.write1);
+    stats_init(&dec.write0);
+    dec.reset_low_min = 1e30;
+    dec.presence_margin_min = 1e30;
+    dec.recovery_min = 1e30;
+    dec.slot_period_min = 1e30;
+
+    begin = clock();
+
+    if (binary)
+    {
+        decode_binary(&dec, fp, channel);
+    }
+
+    else
+    {
+        decode_csv(&dec, fp, channel);
+    }
+
+    fclose(fp);
+    flush_transaction(&dec);
+    print_report(&dec, (double)(clock() - begin) / CLOCKS_PER_SEC);
+
+    return EXIT_SUCCESS;
+}
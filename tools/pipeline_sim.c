@@ -0,0 +1,428 @@
+/***************************************************************
+ * @file pipeline_sim.c
+ *
+ * @par Nicholas Shanahan (2018)
+ *
+ * @brief Host benchmark of the multi-bus pipeline. The OWI layer
+ * is replaced by simulated buses of DS18B20 devices running on a
+ * virtual clock: every reset advances it by OWI_RESET_US and every
+ * bit slot by OWI_SLOT_US, and a conversion started on a bus
+ * finishes DS18B20_CONVERSION_MS later. The driver, table and
+ * pipeline modules run unmodified on top.
+ *
+ * For 1 to 8 buses the tool reports samples per second for
+ * sequential sweeps (ds18b20_table_sweep() on one bus after the
+ * other), for pipelined sweeps (ds18b20_pipeline_sweep()) and the
+ * bound from ds18b20_pipeline_bound_sps(). Only bus time is
+ * simulated, CPU time between slots is taken as zero.
+ *
+ * It also checks that a bus dying during a conversion counts its
+ * devices as errors once, and that it is picked up again.
+ *
+ * Build:  cc -O2 -Itools/sim -o pipeline_sim tools/pipeline_sim.c \
+ *           DS18B20.c DS18B20_table.c DS18B20_pipeline.c owi_crc.c
+ * Usage:  pipeline_sim [-d devices_per_bus] [-n sweeps]
+ *
+ **************************************************************/
+
+/**************************************************************
+                            Includes
+***************************************************************/
+#include "../owi.h"
+#include "../owi_crc.h"
+#include "../owi_delay.h"
+#include "../DS18B20.h"
+#include "../DS18B20_table.h"
+#include "../DS18B20_pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**************************************************************
+                            Macros
+***************************************************************/
+#define MAX_BUSES DS18B20_PIPELINE_MAX_BUSES
+#define SCRATCHPAD_LEN_BYTES 9
+
+//commands the simulated devices act on
+#define SKIP_ROM_CMD         0xCC
+#define CONVERT_TEMP_CMD     0x44
+#define READ_SCRATCHPAD_CMD  0xBE
+
+/**************************************************************
+                            Typedefs
+***************************************************************/
+typedef enum {
+    BUS_ROM_CMD,
+    BUS_FUNC_CMD,
+    BUS_READ,
+    BUS_IGNORE
+} bus_state_t;
+
+typedef struct {
+    bool        dead;
+    double      deadline_us;
+    bus_state_t state;
+    uint8_t     scratchpad[SCRATCHPAD_LEN_BYTES];
+    uint8_t     read_idx;
+    uint8_t     match;
+} sim_bus_t;
+
+/**************************************************************
+                            Variables
+***************************************************************/
+double sim_clock_us = 0;
+
+static sim_bus_t buses[MAX_BUSES];
+static ds18b20_table_t tables[MAX_BUSES];
+
+/**************************************************************
+                      Simulated OWI Layer
+***************************************************************/
+void owi_init(uint8_t pin)
+{
+    memset(&buses[pin], 0, sizeof(buses[pin]));
+}
+
+bool owi_is_busy(uint8_t pin)
+{
+    sim_clock_us += OWI_SLOT_US;
+
+    //a bus without devices floats high and reads as idle
+    return !buses[pin].dead && (sim_clock_us < buses[pin].deadline_us);
+}
+
+bool owi_detect_presence(uint8_t pin)
+{
+    sim_clock_us += OWI_RESET_US;
+    buses[pin].state = BUS_ROM_CMD;
+
+    return !buses[pin].dead;
+}
+
+void owi_send_byte(uint8_t data, uint8_t pin)
+{
+    sim_bus_t *bus = &buses[pin];
+    uint8_t idx;
+    int16_t raw;
+
+    sim_clock_us += 8 * OWI_SLOT_US;
+
+    if (bus->state == BUS_ROM_CMD)
+    {
+        bus->state = (data == SKIP_ROM_CMD) ? BUS_FUNC_CMD : BUS_IGNORE;
+    }
+
+    else if ((bus->state == BUS_FUNC_CMD) && (data == CONVERT_TEMP_CMD))
+    {
+        bus->deadline_us = sim_clock_us + (DS18B20_CONVERSION_MS * 1000.0);
+        bus->state = BUS_IGNORE;
+    }
+
+    else if ((bus->state == BUS_FUNC_CMD) && (data == READ_SCRATCHPAD_CMD))
+    {
+        //each device reads 25 C plus its serial byte in LSBs
+        raw = (int16_t)(0x0190 + (bus->match & 0x3F));
+        bus->scratchpad[0] = raw & 0xFF;
+        bus->scratchpad[1] = (raw >> 8) & 0xFF;
+        bus->scratchpad[2] = 0x4B;
+        bus->scratchpad[3] = 0x46;
+        bus->scratchpad[4] = 0x7F;
+        bus->scratchpad[5] = 0xFF;
+        bus->scratchpad[6] = 0x10;
+        bus->scratchpad[7] = 0x10;
+        bus->scratchpad[8] = 0;
+
+        for (idx = 0; idx < SCRATCHPAD_LEN_BYTES - 1; idx++)
+        {
+            bus->scratchpad[8] = crc8(bus->scratchpad[idx], bus->scratchpad[8]);
+        }
+
+        bus->read_idx = 0;
+        bus->state = BUS_READ;
+    }
+
+    else
+    {
+        bus->state = BUS_IGNORE;
+    }
+}
+
+uint8_t owi_recv_byte(uint8_t pin)
+{
+    sim_bus_t *bus = &buses[pin];
+
+    sim_clock_us += 8 * OWI_SLOT_US;
+
+    if (bus->dead || (bus->state != BUS_READ) ||
+        (bus->read_idx >= SCRATCHPAD_LEN_BYTES))
+    {
+        return 0xFF;
+    }
+
+    return bus->scratchpad[bus->read_idx++];
+}
+
+void owi_skip_rom(uint8_t pin)
+{
+    owi_send_byte(SKIP_ROM_CMD, pin);
+}
+
+void owi_match_rom(uint8_t *rom, uint8_t pin)
+{
+    //command byte and 8 ROM bytes
+    sim_clock_us += 9 * 8 * OWI_SLOT_US;
+    buses[pin].match = rom[1];
+
+    if (buses[pin].state == BUS_ROM_CMD)
+    {
+        buses[pin].state = BUS_FUNC_CMD;
+    }
+}
+
+void owi_read_rom(uint8_t *rom, uint8_t pin)
+{
+    sim_clock_us += 8 * 8 * OWI_SLOT_US;
+    memset(rom, 0xFF, DS18B20_ROM_LEN_BYTES);
+    (void)pin;
+}
+
+uint8_t owi_search_rom(uint8_t *rom, uint8_t last_deviation, uint8_t pin)
+{
+    (void)rom;
+    (void)last_deviation;
+    (void)pin;
+
+    //tables are filled with ds18b20_table_add() instead
+    return OWI_ROM_SEARCH_FAILED;
+}
+
+/**************************************************************
+                            Benchmark
+***************************************************************/
+/*!
+ * @brief Sets up a table with the given number of devices on
+ * each of the given number of buses.
+ */
+static void setup_buses(unsigned count, unsigned devices)
+{
+    uint8_t rom[DS18B20_ROM_LEN_BYTES];
+    unsigned bus;
+    unsigned dev;
+    int idx;
+
+    for (bus = 0; bus < count; bus++)
+    {
+        ds18b20_table_init(&tables[bus], (uint8_t)bus);
+
+        for (dev = 0; dev < devices; dev++)
+        {
+            //ROM in driver order, family code last and CRC first
+            memset(rom, 0, sizeof(rom));
+            rom[DS18B20_ROM_FAMILY_IDX] = DS18B20_FAMILY_CODE;
+            rom[2] = (uint8_t)bus;
+            rom[1] = (uint8_t)dev;
+            rom[DS18B20_ROM_CRC_IDX] = 0;
+
+            for (idx = DS18B20_ROM_FAMILY_IDX; idx > DS18B20_ROM_CRC_IDX; idx--)
+            {
+                rom[DS18B20_ROM_CRC_IDX] = crc8(rom[idx], rom[DS18B20_ROM_CRC_IDX]);
+            }
+
+            ds18b20_table_add(&tables[bus], rom);
+        }
+    }
+}
+
+static uint32_t count_valid(unsigned count)
+{
+    uint32_t valid = 0;
+    unsigned bus;
+    unsigned idx;
+
+    for (bus = 0; bus < count; bus++)
+    {
+        for (idx = 0; idx < tables[bus].count; idx++)
+        {
+            valid += ds18b20_table_is_valid(&tables[bus], (uint8_t)idx);
+        }
+    }
+
+    return valid;
+}
+
+/*!
+ * @brief Samples per second of plain sweeps, one bus after the
+ * other.
+ */
+static double run_sequential(unsigned count, unsigned devices, unsigned sweeps)
+{
+    uint32_t samples = 0;
+    double start;
+    unsigned iter;
+    unsigned bus;
+
+    setup_buses(count, devices);
+    start = sim_clock_us;
+
+    for (iter = 0; iter < sweeps; iter++)
+    {
+        for (bus = 0; bus < count; bus++)
+        {
+            ds18b20_table_sweep(&tables[bus]);
+        }
+
+        samples += count_valid(count);
+    }
+
+    return (samples * 1e6) / (sim_clock_us - start);
+}
+
+/*!
+ * @brief Samples per second of pipelined sweeps once the
+ * pipeline is running, along with the modeled bound.
+ */
+static double run_pipelined(unsigned count, unsigned devices, unsigned sweeps,
+                            double *bound)
+{
+    ds18b20_pipeline_t pipe;
+    double start;
+    unsigned iter;
+    unsigned bus;
+
+    setup_buses(count, devices);
+    ds18b20_pipeline_init(&pipe);
+
+    for (bus = 0; bus < count; bus++)
+    {
+        ds18b20_pipeline_add(&pipe, &tables[bus]);
+    }
+
+    //fill the pipeline before measuring
+    ds18b20_pipeline_sweep(&pipe);
+    ds18b20_pipeline_reset_stats(&pipe);
+    start = sim_clock_us;
+
+    for (iter = 0; iter < sweeps; iter++)
+    {
+        ds18b20_pipeline_sweep(&pipe);
+    }
+
+    *bound = ds18b20_pipeline_bound_sps(&pipe);
+
+    return ds18b20_pipeline_achieved_sps(&pipe,
+                                         (uint32_t)((sim_clock_us - start) / 1000.0));
+}
+
+/*!
+ * @brief Kills one bus while it converts, checks that its devices
+ * are counted as errors once and that it recovers.
+ */
+static bool check_dead_bus(unsigned devices, unsigned sweeps)
+{
+    ds18b20_pipeline_t pipe;
+    unsigned iter;
+    bool ok = true;
+
+    setup_buses(2, devices);
+    ds18b20_pipeline_init(&pipe);
+    ds18b20_pipeline_add(&pipe, &tables[0]);
+    ds18b20_pipeline_add(&pipe, &tables[1]);
+
+    ds18b20_pipeline_sweep(&pipe);
+    ds18b20_pipeline_reset_stats(&pipe);
+
+    //bus 1 is converting after every sweep
+    buses[1].dead = true;
+
+    for (iter = 0; iter < sweeps; iter++)
+    {
+        ds18b20_pipeline_sweep(&pipe);
+    }
+
+    if ((pipe.errors != devices) || !ds18b20_pipeline_is_down(&pipe, 1))
+    {
+        printf("dead bus: %lu errors for %u devices, down %d\n",
+               (unsigned long)pipe.errors, devices,
+               ds18b20_pipeline_is_down(&pipe, 1));
+        ok = false;
+    }
+
+    buses[1].dead = false;
+
+    for (iter = 0; iter < sweeps; iter++)
+    {
+        ds18b20_pipeline_sweep(&pipe);
+    }
+
+    if (ds18b20_pipeline_is_down(&pipe, 1) || (pipe.errors != devices))
+    {
+        printf("dead bus: not recovered, %lu errors\n", (unsigned long)pipe.errors);
+        ok = false;
+    }
+
+    return ok;
+}
+
+/**************************************************************
+                            Main
+***************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned devices = 10;
+    unsigned sweeps = 20;
+    unsigned count;
+    double bound;
+    double pipelined;
+    int idx;
+
+    for (idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "-d") && (idx + 1 < argc))
+        {
+            devices = (unsigned)atoi(argv[++idx]);
+        }
+
+        else if (!strcmp(argv[idx], "-n") && (idx + 1 < argc))
+        {
+            sweeps = (unsigned)atoi(argv[++idx]);
+        }
+
+        else
+        {
+            fprintf(stderr, "usage: %s [-d devices_per_bus] [-n sweeps]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((devices == 0) || (devices > DS18B20_TABLE_MAX_DEVS) || (sweeps == 0))
+    {
+        fprintf(stderr, "1 to %d devices per bus and at least one sweep\n",
+                DS18B20_TABLE_MAX_DEVS);
+        return EXIT_FAILURE;
+    }
+
+    printf("%u devices per bus, %d-bit resolution, %u sweeps\n\n",
+           devices, DS18B20_RESOLUTION_BITS, sweeps);
+    printf("buses   sequential   pipelined   bound   (samples/s)\n");
+
+    for (count = 1; count <= MAX_BUSES; count++)
+    {
+        pipelined = run_pipelined(count, devices, sweeps, &bound);
+
+        printf("  %u      %7.2f     %7.2f   %7.2f\n", count,
+               run_sequential(count, devices, sweeps), pipelined, bound);
+    }
+
+    if (!check_dead_bus(devices, sweeps * 4))
+    {
+        printf("\nFAIL\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\ndead bus counted once and recovered\n");
+
+    return EXIT_SUCCESS;
+}
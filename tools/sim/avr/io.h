@@ -0,0 +1,14 @@
+/***************************************************************
+ * @file io.h
+ *
+ * @brief Host stand-in for <avr/io.h>, just enough for the
+ * driver, table and pipeline modules to build in tools/.
+ *
+ **************************************************************/
+
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#define _BV(bit) (1U << (bit))
+
+#endif /* _SIM_AVR_IO_H */
@@ -0,0 +1,25 @@
+/***************************************************************
+ * @file delay.h
+ *
+ * @brief Host stand-in for <util/delay.h>. Delays advance the
+ * virtual clock of the simulator instead of busy waiting.
+ *
+ **************************************************************/
+
+#ifndef _SIM_UTIL_DELAY_H
+#define _SIM_UTIL_DELAY_H
+
+//virtual time in microseconds, defined by the simulator
+extern double sim_clock_us;
+
+static inline void _delay_us(double us)
+{
+    sim_clock_us += us;
+}
+
+static inline void _delay_ms(double ms)
+{
+    sim_clock_us += ms * 1000.0;
+}
+
+#endif /* _SIM_UTIL_DELAY_H */
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Round trip check of tools/owi_decode.c: synthesizes N convert/readout
+# cycles, decodes them as a binary and as a CSV capture, and checks
+# the reset count, scratchpad CRCs and the temperature ramp.
+#
+# Usage: tools/test_owi_decode.sh [count]
+#
+
+set -e
+
+COUNT=${1:-100}
+RATE=4000000
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cc -O2 -o "$TMP/owi_decode" "$DIR/owi_decode.c"
+"$TMP/owi_decode" -r $RATE -s "$COUNT" "$TMP/cap.bin"
+
+# sigrok style CSV of the same capture, bus on channel 0
+{
+    echo "; synthesized capture"
+    echo "D0,D1"
+    od -An -v -tu1 -w1 "$TMP/cap.bin" | awk '{ print $1 ",0" }'
+} > "$TMP/cap.csv"
+
+# raw readings ramp from 0x0190 in steps of one LSB, wrapping every 64
+awk -v n="$COUNT" 'BEGIN { for (i = 0; i < n; i++) printf "%.4f\n", (400 + i % 64) * 0.0625 }' \
+    > "$TMP/expected"
+
+fail=0
+
+check() {
+    name=$1
+    shift
+    "$TMP/owi_decode" -r $RATE "$@" > "$TMP/$name.out" 2> /dev/null
+
+    if ! grep -q "^resets *$((2 * COUNT + 1)) ($((2 * COUNT + 1)) with presence)" "$TMP/$name.out"; then
+        echo "$name: expected $((2 * COUNT + 1)) resets with presence"
+        fail=1
+    fi
+
+    if ! grep -q "(0 scratchpad CRC errors)" "$TMP/$name.out"; then
+        echo "$name: scratchpad CRC errors"
+        fail=1
+    fi
+
+    grep -o "[-0-9.]* C$" "$TMP/$name.out" | cut -d' ' -f1 > "$TMP/$name.temps"
+
+    if ! cmp -s "$TMP/expected" "$TMP/$name.temps"; then
+        echo "$name: temperatures do not follow the ramp"
+        fail=1
+    fi
+}
+
+check binary -b "$TMP/cap.bin"
+check csv "$TMP/cap.csv"
+
+if [ $fail -ne 0 ]; then
+    echo "FAIL"
+    exit 1
+fi
+
+echo "PASS ($COUNT cycles, binary and CSV)"